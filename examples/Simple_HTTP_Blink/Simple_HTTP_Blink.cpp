@@ -10,6 +10,7 @@
 //
 // Test working with (replace with proper IP address if changed):
 // curl -i -X GET "http://192.168.1.68"                        -> return HTTP identify
+// curl -i -X GET "http://192.168.1.68/index.html"             -> return control page (from flash)
 // curl -i -X GET "http://192.168.1.68/blink"                  -> show blinking status
 // curl -i -X PUT "http://192.168.1.68/blink?state=on"         -> switch blinking on
 //          -> switch blinking off
@@ -40,8 +41,23 @@ SimpleWebServer server( SERVER_NAME, SERVER_PORT);          // web server instan
 
 bool ledStatus;                                             // ledStatus on startup
 
-void handleBlink_GET();                                     // callback for API GET handling
-void handleBlink_PUT();                                     // callback for API PUT handling
+void handleBlink_GET( RequestContext&);                     // callback for API GET handling
+void handleBlink_PUT( RequestContext&);                     // callback for API PUT handling
+
+const SimpleWebRoute routes[] PROGMEM = {                   // route table (stored in flash)
+  HTTP_ROUTE( "blink", HTTP_GET, handleBlink_GET),          // set callback for GET on "blink"
+  HTTP_ROUTE( "blink", HTTP_PUT, handleBlink_PUT),          // set callback for PUT on "blink"
+};
+
+static const char index_html[] PROGMEM =                    // control page (stored in flash)
+  "<html><body><h1>" SERVER_NAME "</h1>"
+  "<button onclick=\"fetch('/blink?state=on',{method:'PUT'})\">on</button>"
+  "<button onclick=\"fetch('/blink?state=off',{method:'PUT'})\">off</button>"
+  "</body></html>";
+
+const SimpleWebAsset assets[] PROGMEM = {                   // asset table (stored in flash)
+  HTTP_ASSET( "/index.html", "text/html", index_html),      // control page (ETag / 304 handled by server)
+};
 
 void setup() {
   BEGIN( 9600) LF;                                        // activate Serial out
@@ -70,8 +86,8 @@ void setup() {
 #endif
 
   server.begin();                                           // start webserver
-  server.handleOn( handleBlink_GET, "blink", HTTP_GET);     // set callback for GET on "blink"
-  server.handleOn( handleBlink_PUT, "blink", HTTP_PUT);     // set function for PUT on "blink"
+  server.handleOn( routes);                                 // set callbacks for "blink"
+  server.serveStatic( assets);                              // set static assets (control page)
 
   PRINT( F( "# ready for HTTP requests")) LF;
   PRINT( F( "#")) LF;
@@ -82,37 +98,37 @@ void loop() {
 }
 
 // handle on "blink" GET commands
-void handleBlink_GET()
+void handleBlink_GET( RequestContext& request)
 {                                                           // check on path / args boundaries
-  if (( server.pathCount() > 1) || ( server.argsCount() > 0)) return;
+  if (( request.pathCount() > 1) || ( request.argsCount() > 0)) return;
 
   bool state = digitalRead( 2);
 
-  server.respond( returnCode = 200, "text/plain");          // response to client
-  server.sendLine( F( "led = "), state ? CMD_ON : CMD_OFF);
+  request.respond( 200, "text/plain");                      // response to client
+  request.sendLine( F( "led = "), state ? CMD_ON : CMD_OFF);
 
   LABEL( F( "# Led = "), state) LF;                         // response to console
 }
 
 // handle on "blink" PUT commands
-void handleBlink_PUT()
+void handleBlink_PUT( RequestContext& request)
 {                                                           // check on path / args boundaries
-  if (( server.pathCount() > 1) || ( server.argsCount() > 1)) return;
+  if (( request.pathCount() > 1) || ( request.argsCount() > 1)) return;
 
   pinMode( LED_DEFAULT, OUTPUT);                            // set LED output mode
 
-  if ( server.arg( "state", CMD_ON )) {
+  if ( request.arg( "state", CMD_ON )) {
     digitalWrite( LED_DEFAULT, LED_ON);                     // switch led on
-    server.respond( returnCode = 200, "text/plain");        // response to client
-    server.sendLine( F( "led switched "), CMD_ON );
+    request.respond( 200, "text/plain");                    // response to client
+    request.sendLine( F( "led switched "), CMD_ON );
                                                             // respond to client
     LABEL( F( "# Led switched "), CMD_ON ) LF;              // respond to server console
   }
 
-  if ( server.arg( "state", CMD_OFF)) {
+  if ( request.arg( "state", CMD_OFF)) {
     digitalWrite( LED_DEFAULT, LED_OFF);                    // switch led off
-    server.respond( returnCode = 200, "text/plain");        // response to client
-    server.sendLine( F( "led switched "), CMD_OFF);
+    request.respond( 200, "text/plain");                    // response to client
+    request.sendLine( F( "led switched "), CMD_OFF);
 
     LABEL( F( "# Led switched "), CMD_OFF) LF;              // respond to server console
   }
@@ -84,8 +84,14 @@ void setup() {
 #endif
 
   server.begin();                                           // starting webserver
-  server.handleOn( handleRelay_GET, "relays", HTTP_GET);    // set function for "/relays"
-  server.handleOn( handleRelay_PUT, "relays", HTTP_PUT);    // set function for "/relays"
+  server.handleOn( handleRelay_GET, "/relays"         , HTTP_GET);
+  server.handleOn( handleRelay_GET, "/relays/{id:int}", HTTP_GET);
+  server.handleOn( handleRelay_PUT, "/relays"         , HTTP_PUT);
+  server.handleOn( handleRelay_PUT, "/relays/{id:int}", HTTP_PUT);
+                                                            // set functions for "/relays" and "/relays/<n>"
+#if defined(ESP8266)
+  server.cache( 1024);                                      // cache GET responses (max 1024 bytes of heap)
+#endif                                                      // (no cache on AVR = 2 KB RAM, no heap use)
   configRelay();                                            // prepare relays (defauls = all off)
 
   PRINT( F( "# ready for HTTP requests")) LF;
@@ -98,14 +104,13 @@ void loop() {
 
 // handle GET on "relay" commands
 void handleRelay_GET()
-{                                                           // check on path / args boundaries
-  if (( server.pathCount() <  1) || ( server.pathCount() > 2)) return;
+{                                                           // check on args boundaries
   if (( server.argsCount() <  0) || ( server.argsCount() > 1)) return;
   if (( server.pathCount() == 2) && ( server.argsCount() > 0)) return;
 
   char        reply[256]; strClr( reply);                   // reply buffer
-  const char* index      = server.path( 1);                 // relay index string
-  uint8_t     relay      = index ? atoi( index) : 0;        // relay index value
+  const char* index      = server.param( "id");             // relay index string
+  uint8_t     relay      = server.paramInt( "id");          // relay index value
   uint8_t     state      = RELAY_ANY;                       // relay state
 
   state = server.arg( "state", CMD_ON ) ? RELAY_ON : state; // get requested state = on
@@ -122,12 +127,11 @@ void handleRelay_GET()
 
 // handle PUT on "relay" commands
 void handleRelay_PUT()
-{                                                           // check on path / args boundaries
-  if (( server.pathCount() < 1) || ( server.pathCount() > 2)) return;
+{                                                           // check on args boundaries
   if (( server.argsCount() < 1) || ( server.argsCount() > 1)) return;
 
-  const char* index = server.path( 1);                      // relay index string
-  uint8_t     relay = index ? atoi( index) : 0;             // relay index value
+  const char* index = server.param( "id");                  // relay index string
+  uint8_t     relay = server.paramInt( "id");               // relay index value
   uint8_t     state = RELAY_ANY;                            // relay state
 
   state = server.arg( "state", CMD_ON ) ? RELAY_ON : state; // get requested state = on
@@ -140,6 +144,8 @@ void handleRelay_PUT()
     updateRelay( state);                                    // set state for all relays
     server.respond( returnCode = 200);                      // send OK to client
   }
+
+  server.invalidate( "relays");                             // drop cached GET responses on "/relays"
 }
 
 // initialize pins with relays inactive
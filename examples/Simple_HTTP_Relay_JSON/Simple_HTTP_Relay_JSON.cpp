@@ -58,8 +58,8 @@ void configRelay( void);
 void updateRelay( uint8_t);
 void updateRelay( uint8_t, uint8_t);
 
-void relay2Json ( char*, size_t, uint8_t);
-void relay2Json ( char*, size_t, uint8_t, uint8_t);
+void relay2Json ( uint8_t);
+void relay2Json ( uint8_t, uint8_t);
 
 void setup() {
   BEGIN( 115200) LF;                                        // open serial communications
@@ -106,7 +106,6 @@ void handleRelay_GET()
   if (( server.argsCount() <  0) || ( server.argsCount() > 1)) return;
   if (( server.pathCount() == 2) && ( server.argsCount() > 0)) return;
 
-  char        reply[256]; strClr( reply);                   // reply buffer
   const char* index      = server.path( 1);                 // relay index string
   uint8_t     relay      = index ? atoi( index) : 0;        // relay index value
   uint8_t     state      = RELAY_ANY;                       // relay state
@@ -115,11 +114,9 @@ void handleRelay_GET()
   state = server.arg( "state", CMD_OFF) ? RELAY_OFF: state; // check on state = CMD_OFF
 
   if ( index) {                                             // if specific relay is speciified
-    relay2Json( reply, sizeof( reply), relay, state);       // store specific relay in json
-    server.respond( returnCode = 200, "text/plain", reply); // send OK + reply to client
+    relay2Json( relay, state);                              // send specific relay in json to client
   } else {
-    relay2Json( reply, sizeof( reply),        state);       // store all relays in json
-    server.respond( returnCode = 200, "text/plain", reply); // send OK + reply to client
+    relay2Json(        state);                              // send all relays in json to client
   }
 }
 
@@ -172,8 +169,8 @@ void updateRelay( uint8_t i, uint8_t state)
   }
 }
 
-// generate JSON for all relays
-void relay2Json( char* content, size_t size, uint8_t state)
+// send JSON for all relays (streamed to client, no reply buffer)
+void relay2Json( uint8_t state)
 {
   StaticJsonBuffer<256> jsonBuffer;                         // create buffer
   JsonArray& root     = jsonBuffer.createArray();           // create array
@@ -186,11 +183,13 @@ void relay2Json( char* content, size_t size, uint8_t state)
     }
   }
 
-  root.printTo( content, size);                             // write to char buffer
+  server.respond( returnCode = 200, "text/plain", root.measureLength());
+                                                            // send OK + content size to client
+  root.printTo( server);                                    // write json directly to client
 }
 
-// generate JSON for relay item i
-void relay2Json( char* content, size_t size, uint8_t i, uint8_t state)
+// send JSON for relay item i (streamed to client, no reply buffer)
+void relay2Json( uint8_t i, uint8_t state)
 {
   if (( i >= 0) & ( i < RELAY_COUNT)) {                     // check if relay is valid
     StaticJsonBuffer<128> jsonBuffer;                       // create buffer
@@ -200,8 +199,10 @@ void relay2Json( char* content, size_t size, uint8_t i, uint8_t state)
     item[ "relay"] = i;                                     // write object
     item[ "state"] = ( relaySet[ i] == RELAY_ON) ? CMD_ON : CMD_OFF;
 
-    root.printTo( content, size);                           // write to char buffer
+    server.respond( returnCode = 200, "text/plain", root.measureLength());
+                                                            // send OK + content size to client
+    root.printTo( server);                                  // write json directly to client
   } else {
-    strClr( content);                                       // clear char buffer
+    server.respond( returnCode = 200, "text/plain", "");    // send OK + empty reply to client
   }
 }
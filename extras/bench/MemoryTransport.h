@@ -0,0 +1,80 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Linux (host build)
+// Library    : Simple WebServer Library for Arduino & ESP8266
+// File       : MemoryTransport.h
+// Purpose    : in-memory transport for benchmarks and tests (see SimpleTransport.h, HTTP_TRANSPORT_INCLUDE)
+// Repository : https://github.com/DennisB66/Simple-WebServer-Library-for-Arduino
+
+#ifndef _MEMORY_TRANSPORT_H
+#define _MEMORY_TRANSPORT_H
+
+#include <Arduino.h>
+
+#include <string>
+
+struct MemorySession                                        // client side of an in-memory session
+{
+  const char*   input;                                      // request data (sent to server)
+  size_t        size;                                       // size of request data
+  size_t        pos;                                        // request data read by server
+  unsigned long bytes;                                      // response bytes written by server
+  unsigned long writes;                                     // response write calls by server
+  bool          open;                                       // true = session open
+  std::string*  output;                                     // response data (NULL = counted only)
+  bool          full;                                       // true = client accepts no data (send buffer full)
+
+  void load( const char* data, size_t count) { input = data; size = count; pos = 0; }
+};
+
+class MemoryClient                                          // server side of an in-memory session
+{
+public:
+  MemoryClient( MemorySession* session = NULL) : _session( session) {}
+
+  int     available()                       { return _session ? _session->size - _session->pos : 0; }
+  int     read( uint8_t* data, size_t size)
+  {
+    if ( size > (size_t) available()) size = available();
+    if ( !size) return -1;
+
+    memcpy( data, _session->input + _session->pos, size);
+    _session->pos += size;
+
+    return size;
+  }
+  size_t  write( const uint8_t* data, size_t size)
+  {
+    if ( !connected() || _session->full) return 0;
+
+    _session->bytes  += size;                               // response is counted (stored if output is set)
+    _session->writes ++;
+    if ( _session->output) _session->output->append( (const char*) data, size);
+
+    return size;
+  }
+  void    flush()                           {}
+  void    stop()                            { if ( _session) _session->open = false; _session = NULL; }
+  uint8_t connected()                       { return _session && _session->open; }
+
+  operator bool()                           { return _session != NULL; }
+  bool operator==( const MemoryClient& c)   { return _session == c._session; }
+
+protected:
+  MemorySession* _session;                                  // client side (NULL = no client)
+};
+
+class MemoryServer                                          // hands out one pending session
+{
+public:
+  MemoryServer( uint16_t) : _session( NULL) {}
+
+  void         begin()                      {}
+  MemoryClient available()                  { return ( _session && _session->open) ? MemoryClient( _session) : MemoryClient(); }
+  void         attach( MemorySession* s)    { _session = s; }
+
+protected:
+  MemorySession* _session;                                  // pending session (NULL = none)
+};
+
+#endif
@@ -0,0 +1,294 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Linux (host build)
+// Library    : Simple WebServer Library for Arduino & ESP8266
+// File       : SimpleWebServerBench.cpp
+// Purpose    : benchmark of request parser, dispatch and response writer over an in-memory transport
+// Repository : https://github.com/DennisB66/Simple-WebServer-Library-for-Arduino
+//
+// Usage: SimpleWebServerBench [--json] [--iterations N]
+//
+// Each request of the corpus is sent N times over a persistent in-memory session and served by handle(),
+// the same path as a sketch. The callbacks take a time stamp on entry, splitting handle() at the callback;
+// the parser is also timed on its own (_parseRequest() on the request data, N times):
+//   parse    = _parseRequest() only
+//   dispatch = handle() until the callback minus parse (accept, read, route match)
+//   respond  = callback until handle() returns (respond() with the response content, flush, keep-alive)
+// The identify request ("GET /") has no callback: its response is counted as dispatch.
+// --json prints one JSON object per line (per request + "all"), e.g. to compare builds of two commits.
+
+#include "SimpleWebServer.h"
+
+#include <time.h>
+
+#define BENCH_ITERATIONS 100000                             // default number of requests per corpus entry
+#define BENCH_WARMUP       1000                             // requests before timing starts
+#define BENCH_HANDLE         16                             // max handle() calls to answer a request
+
+#define PARSE_NEED_MORE       0                             // parser results (as in SimpleWebServer.cpp)
+#define PARSE_COMPLETE        1
+
+#define POSTMAN_HEAD "Host: 192.168.1.68\r\n" \
+                     "User-Agent: PostmanRuntime/7.26.8\r\n" \
+                     "Accept: */*\r\n" \
+                     "Cache-Control: no-cache\r\n" \
+                     "Postman-Token: 5f9d7e52-0d64-4c5c-9b1e-2a8f3c1d7e46\r\n" \
+                     "Accept-Encoding: gzip, deflate, br\r\n" \
+                     "Connection: keep-alive\r\n"
+
+struct BenchRequest                                         // corpus entry
+{
+  const char* name;                                         // request line (short)
+  const char* request;                                      // full request
+  const char* content;                                      // response content (NULL = no callback)
+};
+
+// Requests copied by hand from examples/*.postman_collection.json (Postman adds the POSTMAN_HEAD lines),
+// keep in sync when the collections change.
+static const BenchRequest corpus[] = {
+  { "GET /"                     , "GET / HTTP/1.1\r\n" POSTMAN_HEAD "\r\n"
+                                , NULL },
+  { "GET /blink"                , "GET /blink HTTP/1.1\r\n" POSTMAN_HEAD "\r\n"
+                                , "led = on\r\n" },
+  { "PUT /blink?state=on"       , "PUT /blink?state=on HTTP/1.1\r\n" POSTMAN_HEAD "Content-Length: 0\r\n\r\n"
+                                , "led switched on\r\n" },
+  { "GET /relays"               , "GET /relays HTTP/1.1\r\n" POSTMAN_HEAD "\r\n"
+                                , "# relay 00 on pin 02 = on\r\n# relay 01 on pin 03 = off\r\n"
+                                  "# relay 02 on pin 04 = off\r\n# relay 03 on pin 05 = on\r\n" },
+  { "GET /relays?state=on"      , "GET /relays?state=on HTTP/1.1\r\n" POSTMAN_HEAD "\r\n"
+                                , "# relay 00 on pin 02 = on\r\n# relay 03 on pin 05 = on\r\n" },
+  { "GET /relays/3"             , "GET /relays/3 HTTP/1.1\r\n" POSTMAN_HEAD "\r\n"
+                                , "# relay 03 on pin 05 = on\r\n" },
+  { "PUT /relays?state=off"     , "PUT /relays?state=off HTTP/1.1\r\n" POSTMAN_HEAD "Content-Length: 0\r\n\r\n"
+                                , "" },
+  { "PUT /relays/3?state=on"    , "PUT /relays/3?state=on HTTP/1.1\r\n" POSTMAN_HEAD "Content-Length: 0\r\n\r\n"
+                                , "" },
+};
+
+#define CORPUS_SIZE ( sizeof( corpus) / sizeof( corpus[0]))
+
+// return monotonic time (ns)
+static inline unsigned long long nanos()
+{
+  struct timespec now;
+
+  clock_gettime( CLOCK_MONOTONIC, &now);
+
+  return ( unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// return cost (ns) of one nanos() call (subtracted from each stage)
+static double nanosCost()
+{
+  const int          count = 100000;
+  unsigned long long start = nanos();
+
+  for ( int i = 0; i < count; i++) nanos();
+
+  return ( double) ( nanos() - start) / count;
+}
+
+static const BenchRequest* current = NULL;                  // corpus entry being served
+static unsigned long long  stamp   = 0;                     // time of callback entry (0 = no callback)
+
+// dispatch targets (same routes as the examples, without hardware), respond with the corpus content
+static void handleBlink( RequestContext& request)
+{
+  stamp = nanos();                                          // end of request stage
+
+  request.arg( "state");
+  request.respond( 200, "text/plain", current->content);
+}
+
+static void handleRelay( RequestContext& request)
+{
+  stamp = nanos();                                          // end of request stage
+
+  request.paramInt( "id");
+  request.arg( "state");
+  request.respond( 200, "text/plain", current->content);
+}
+
+const SimpleWebRoute routes[] PROGMEM = {                   // route table (as Simple_HTTP_Blink)
+  HTTP_ROUTE( "blink", HTTP_GET, handleBlink),
+  HTTP_ROUTE( "blink", HTTP_PUT, handleBlink),
+};
+
+struct BenchResult                                          // result of one corpus entry
+{
+  double parse;                                             // ns per request (per stage)
+  double dispatch;
+  double respond;
+  double bytes;                                             // response bytes per request
+  double writes;                                            // write calls per request
+};
+
+class SimpleWebServerBench : public SimpleWebServer         // server with in-memory transport
+{
+public:
+  SimpleWebServerBench() : SimpleWebServer( (char*) "Bench") {}
+
+  void attach( MemorySession* session) { _server.attach( session); }
+
+  // parse request in slot 0 (free between runs), fed in buffer sized parts as by handle(), returns parser result
+  uint8_t parse( const char* request, size_t size)
+  {
+    uint8_t result = PARSE_NEED_MORE;
+
+    _conn         = _conns;
+    _conn->count  = 0;
+    _conn->parsed = 0;
+    _conn->mode   = 0;                                      // SERVER_METH_INIT
+
+    while ( size && ( result == PARSE_NEED_MORE)) {
+      size_t part = _bufferSize - 1 - _conn->count;         // free space in request buffer
+
+      if ( part > size) part = size;
+      memcpy( _conn->buffer + _conn->count, request, part);
+      _conn->count += part;
+      _conn->buffer[ _conn->count] = 0;                     // keep buffer terminated
+      request      += part;
+      size         -= part;
+
+      result = _parseRequest();
+    }
+
+    return result;
+  }
+};
+
+SimpleWebServerBench server;
+
+// serve request n times with handle() (timed after warmup), server closes the session after HTTP_KEEPALIVE_MAX requests
+static BenchResult run( const BenchRequest& entry, long n, double cost)
+{
+  MemorySession      session = { NULL, 0, 0, 0, 0, true, NULL, false};
+  double             ask     = 0;                           // ns in handle() until callback (sum)
+  double             reply   = 0;                           // ns in respond stage (sum)
+  unsigned long      bytes   = 0;
+  unsigned long      writes  = 0;
+  size_t             size    = strlen( entry.request);
+
+  current = &entry;
+  server.attach( &session);
+
+  for ( long i = -BENCH_WARMUP; i < n; i++) {
+    if ( i == 0) { ask = reply = 0; bytes = session.bytes; writes = session.writes; }
+
+    session.load( entry.request, size);
+    session.open = true;                                    // reopen session closed by server
+
+    unsigned long      count = session.writes;              // response = new write calls
+    unsigned long long t0    = nanos();
+    int                tries = 0;
+
+    stamp = 0;
+
+    while (( session.writes == count) && ( tries++ < BENCH_HANDLE)) server.handle();
+
+    unsigned long long t1 = nanos();
+
+    if ( session.writes == count) {                         // no response (e.g. invalid request)
+      fprintf( stderr, "no response to \"%s\" after %d handle() calls\n", entry.name, BENCH_HANDLE);
+      exit( 1);
+    }
+
+    if ( stamp) {                                           // callback = split at time stamp
+      ask   += stamp - t0 - cost;
+      reply += t1 - stamp - cost;
+    } else {                                                // no callback = all request stage
+      ask   += t1 - t0 - cost;
+    }
+  }
+
+  session.open = false;                                     // close session = slot 0 free for parse loop
+  for ( int i = 0; i < BENCH_HANDLE; i++) server.handle();
+  server.attach( NULL);
+
+  double parse = 0;                                         // ns in parser (sum)
+
+  for ( long i = -BENCH_WARMUP; i < n; i++) {
+    if ( i == 0) parse = 0;
+
+    unsigned long long t0     = nanos();
+    uint8_t            result = server.parse( entry.request, size);
+    unsigned long long t1     = nanos();
+
+    if ( result != PARSE_COMPLETE) {
+      fprintf( stderr, "parser rejects \"%s\" (result %d)\n", entry.name, result);
+      exit( 1);
+    }
+
+    parse += t1 - t0 - cost;
+  }
+
+  BenchResult result;
+
+  result.parse    = parse / n;
+  result.dispatch = ask   / n - result.parse;
+  result.respond  = reply / n;
+  result.bytes   = ( double) ( session.bytes  - bytes ) / n;
+  result.writes  = ( double) ( session.writes - writes) / n;
+
+  return result;
+}
+
+// print result (as table row or JSON line)
+static void report( const char* name, const BenchResult& r, long n, bool json)
+{
+  double total = r.parse + r.dispatch + r.respond;
+
+  if ( json) {
+    printf( "{\"bench\":\"SimpleWebServer\",\"request\":\"%s\",\"iterations\":%ld,"
+            "\"parse_ns\":%.1f,\"dispatch_ns\":%.1f,\"respond_ns\":%.1f,\"total_ns\":%.1f,"
+            "\"bytes\":%.1f,\"writes\":%.2f}\n",
+            name, n, r.parse, r.dispatch, r.respond, total, r.bytes, r.writes);
+  } else {
+    printf( "%-28s %9.1f %11.1f %10.1f %9.1f %8.1f %7.2f\n",
+            name, r.parse, r.dispatch, r.respond, total, r.bytes, r.writes);
+  }
+}
+
+int main( int argc, char** argv)
+{
+  bool json = false;
+  long n    = BENCH_ITERATIONS;
+
+  for ( int i = 1; i < argc; i++) {
+    if ( !strcmp( argv[ i], "--json")) json = true;
+    else if ( !strcmp( argv[ i], "--iterations") && ( i + 1 < argc)) n = atol( argv[ ++i]);
+    else { fprintf( stderr, "usage: %s [--json] [--iterations N]\n", argv[0]); return 1; }
+  }
+
+  if ( n < 1) n = 1;
+
+  server.begin();
+  server.handleOn( routes);                                 // "blink" = route table
+  server.handleOn( handleRelay, "/relays"         , HTTP_GET);
+  server.handleOn( handleRelay, "/relays/{id:int}", HTTP_GET);
+  server.handleOn( handleRelay, "/relays"         , HTTP_PUT);
+  server.handleOn( handleRelay, "/relays/{id:int}", HTTP_PUT);
+                                                            // "/relays" = route trie (as Simple_HTTP_Relay)
+  double      cost = nanosCost();
+  BenchResult all  = { 0, 0, 0, 0, 0};
+
+  if ( !json) {
+    printf( "%-28s %9s %11s %10s %9s %8s %7s\n", "request", "parse ns", "dispatch ns", "respond ns", "total ns", "bytes", "writes");
+  }
+
+  for ( size_t i = 0; i < CORPUS_SIZE; i++) {
+    BenchResult r = run( corpus[ i], n, cost);
+
+    report( corpus[ i].name, r, n, json);
+
+    all.parse    += r.parse    / CORPUS_SIZE;
+    all.dispatch += r.dispatch / CORPUS_SIZE;
+    all.respond  += r.respond  / CORPUS_SIZE;
+    all.bytes    += r.bytes    / CORPUS_SIZE;
+    all.writes   += r.writes   / CORPUS_SIZE;
+  }
+
+  report( "all", all, n, json);
+
+  return 0;
+}
@@ -0,0 +1,149 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Linux (host build)
+// Library    : Simple WebServer Library for Arduino & ESP8266
+// File       : Arduino.cpp
+// Purpose    : minimal Arduino API to build SimpleWebServer natively (see CMakeLists.txt)
+// Repository : https://github.com/DennisB66/Simple-WebServer-Library-for-Arduino
+
+#include "Arduino.h"
+
+#include <time.h>
+#include <sched.h>
+
+HostSerial Serial;
+
+// return time (us) of monotonic clock
+static unsigned long long clockMicros()
+{
+  struct timespec now;
+
+  clock_gettime( CLOCK_MONOTONIC, &now);
+
+  return ( unsigned long long) now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+static unsigned long long startMicros = clockMicros();     // time of program start
+
+// return ms since program start
+unsigned long millis()
+{
+  return ( clockMicros() - startMicros) / 1000;
+}
+
+// return us since program start
+unsigned long micros()
+{
+  return clockMicros() - startMicros;
+}
+
+// sleep (ms)
+void delay( unsigned long ms)
+{
+  delayMicroseconds( ms * 1000);
+}
+
+// sleep (us)
+void delayMicroseconds( unsigned int us)
+{
+  struct timespec wait = { ( time_t) ( us / 1000000), ( long) ( us % 1000000) * 1000 };
+
+  nanosleep( &wait, NULL);
+}
+
+// give up time slice
+void yield()
+{
+  sched_yield();
+}
+
+void pinMode( uint8_t, uint8_t) {}
+void digitalWrite( uint8_t, uint8_t) {}
+int  digitalRead( uint8_t) { return LOW; }
+
+// write block of bytes (one byte at a time unless overridden)
+size_t Print::write( const uint8_t* data, size_t size)
+{
+  size_t n = 0;
+
+  while ( size--) n += write( *data++);
+
+  return n;
+}
+
+size_t Print::print( const __FlashStringHelper* str)
+{
+  return write( (const char*) str);
+}
+
+size_t Print::print( const char* str)
+{
+  return write( str);
+}
+
+size_t Print::print( char c)
+{
+  return write( (uint8_t) c);
+}
+
+size_t Print::print( unsigned char n, int base)
+{
+  return print( (unsigned long) n, base);
+}
+
+size_t Print::print( int n, int base)
+{
+  return print( (long) n, base);
+}
+
+size_t Print::print( unsigned int n, int base)
+{
+  return print( (unsigned long) n, base);
+}
+
+size_t Print::print( long n, int base)
+{
+  char text[24];
+
+  snprintf( text, sizeof( text), base == HEX ? "%lX" : "%ld", n);
+
+  return write( text);
+}
+
+size_t Print::print( unsigned long n, int base)
+{
+  char text[24];
+
+  snprintf( text, sizeof( text), base == HEX ? "%lX" : "%lu", n);
+
+  return write( text);
+}
+
+size_t Print::print( double n, int digits)
+{
+  char text[40];
+
+  snprintf( text, sizeof( text), "%.*f", digits, n);
+
+  return write( text);
+}
+
+size_t Print::println()
+{
+  return write( "\r\n");
+}
+
+size_t HostSerial::write( uint8_t c)
+{
+  return fwrite( &c, 1, 1, stdout);
+}
+
+size_t HostSerial::write( const uint8_t* data, size_t size)
+{
+  return fwrite( data, 1, size, stdout);
+}
+
+void HostSerial::flush()
+{
+  fflush( stdout);
+}
@@ -0,0 +1,115 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Linux (host build)
+// Library    : Simple WebServer Library for Arduino & ESP8266
+// File       : Arduino.h
+// Purpose    : minimal Arduino API to build SimpleWebServer natively (see CMakeLists.txt)
+// Repository : https://github.com/DennisB66/Simple-WebServer-Library-for-Arduino
+
+#ifndef _ARDUINO_HOST_H
+#define _ARDUINO_HOST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+
+typedef uint8_t  byte;
+typedef uint16_t word;
+typedef bool     boolean;
+
+#define HIGH     0x1
+#define LOW      0x0
+#define INPUT    0x0
+#define OUTPUT   0x1
+
+#define DEC      10
+#define HEX      16
+
+#define PROGMEM                                             // flash = normal memory on host
+#define PGM_P    const char*
+#define PSTR( S) ( S)
+
+class __FlashStringHelper;
+#define F( S)    ( reinterpret_cast< const __FlashStringHelper*>( PSTR( S)))
+#define FPSTR( P)( reinterpret_cast< const __FlashStringHelper*>( P))
+
+#define pgm_read_byte( A)  ( *( const uint8_t*    ) ( A))
+#define pgm_read_word( A)  ( *( const uint16_t*   ) ( A))
+#define pgm_read_dword( A) ( *( const uint32_t*   ) ( A))
+#define pgm_read_ptr( A)   ( *( void* const*      ) ( A))
+#define memcpy_P           memcpy
+#define strlen_P           strlen
+#define strcpy_P           strcpy
+#define strcat_P           strcat
+#define strcmp_P           strcmp
+#define strncmp_P          strncmp
+#define strcasecmp_P       strcasecmp
+#define strncasecmp_P      strncasecmp
+
+unsigned long millis();                                     // ms  since start (monotonic clock)
+unsigned long micros();                                     // us  since start (monotonic clock)
+void delay( unsigned long);                                 // sleep (ms)
+void delayMicroseconds( unsigned int);                      // sleep (us)
+void yield();                                               // give up time slice
+
+void pinMode( uint8_t, uint8_t);                            // pins are ignored on host
+void digitalWrite( uint8_t, uint8_t);
+int  digitalRead( uint8_t);
+
+class Print                                                 // output stream (same interface as Arduino core)
+{
+public:
+  virtual ~Print() {}
+
+  virtual size_t write( uint8_t) = 0;
+  virtual size_t write( const uint8_t*, size_t);
+  size_t write( const char* str)                 { return str ? write( (const uint8_t*) str, strlen( str)) : 0; }
+  size_t write( const char* data, size_t size)   { return write( (const uint8_t*) data, size); }
+
+  size_t print( const __FlashStringHelper*);
+  size_t print( const char*);
+  size_t print( char);
+  size_t print( unsigned char, int = DEC);
+  size_t print( int, int = DEC);
+  size_t print( unsigned int, int = DEC);
+  size_t print( long, int = DEC);
+  size_t print( unsigned long, int = DEC);
+  size_t print( double, int = 2);
+
+  size_t println();
+  template< typename T> size_t println( T value)        { size_t n = print( value); return n + println(); }
+  template< typename T> size_t println( T value, int f) { size_t n = print( value, f); return n + println(); }
+
+  virtual void flush() {}
+};
+
+class Stream : public Print                                 // input / output stream
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+class HostSerial : public Stream                            // Serial = stdin / stdout
+{
+public:
+  void   begin( unsigned long) {}
+  size_t write( uint8_t);
+  size_t write( const uint8_t*, size_t);
+  using  Print::write;
+  int    available() { return 0; }
+  int    read()      { return -1; }
+  int    peek()      { return -1; }
+  void   flush();
+  operator bool()    { return true; }
+};
+
+extern HostSerial Serial;
+
+#endif
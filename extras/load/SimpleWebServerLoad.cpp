@@ -0,0 +1,415 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Linux (host build)
+// Library    : Simple WebServer Library for Arduino & ESP8266
+// File       : SimpleWebServerLoad.cpp
+// Purpose    : loopback load generator with latency percentiles (POSIX transport)
+// Repository : https://github.com/DennisB66/Simple-WebServer-Library-for-Arduino
+//
+// Usage: SimpleWebServerLoad [--port N] [--concurrency C] [--duration S] [--keepalive on|off]
+//                            [--mix identify,relays,put[:weight]] [--json]
+//
+// Without --port a relay server (as Simple_HTTP_Relay) is started in a child process on a free port.
+// C clients send requests back to back (each waits for its response) for S seconds; the latency of a
+// request runs from sending (or connecting, without keep-alive) to the last byte of the response.
+// A session closed by the server without (complete) response is an error; with more clients than
+// HTTP_MAX_CONNECTIONS the server only takes over keep-alive slots that are idle, so a run ends with 0 errors.
+
+#include "SimpleWebServer.h"
+
+#include <vector>
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define LOAD_BUFFER_SIZE 1024                               // max size of response header
+#define LOAD_MIX_SIZE      64                               // max number of entries in request mix (incl. weight)
+
+#define SESSION_IDLE        0                               // client state: no request pending
+#define SESSION_CONNECTING  1                               // client state: waiting for connect
+#define SESSION_SENDING     2                               // client state: sending request
+#define SESSION_RECEIVING   3                               // client state: receiving response
+
+struct LoadRequest                                          // request of the mix
+{
+  const char* name;                                         // name used in --mix
+  const char* line;                                         // request line
+};
+
+static const LoadRequest requests[] = {
+  { "identify", "GET / HTTP/1.1"                   },
+  { "relays"  , "GET /relays HTTP/1.1"             },
+  { "put"     , "PUT /relays/3?state=on HTTP/1.1"  },
+};
+
+#define REQUEST_COUNT ( sizeof( requests) / sizeof( requests[0]))
+
+struct LoadSession                                          // client connection
+{
+  int                fd;                                    // socket (-1 = not connected)
+  int                state;                                 // client state
+  char               request[160];                          // request being sent
+  size_t             size;                                  // size of request
+  size_t             sent;                                  // bytes of request sent
+  char               buffer[LOAD_BUFFER_SIZE];              // response header
+  size_t             count;                                 // bytes in buffer
+  bool               body;                                  // true = header received, reading body
+  long               left;                                  // body bytes still expected (-1 = until close)
+  bool               close;                                 // true = server closes after response
+  unsigned long long start;                                 // start of request (ns)
+};
+
+// return monotonic time (ns)
+static inline unsigned long long nanos()
+{
+  struct timespec now;
+
+  clock_gettime( CLOCK_MONOTONIC, &now);
+
+  return ( unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// relay server (as Simple_HTTP_Relay, without hardware)
+
+class LoadServer : public SimpleWebServer                   // server reporting its bound port
+{
+public:
+  LoadServer() : SimpleWebServer( (char*) "NetRelay-01", 0) {}
+
+  uint16_t boundPort() { return _server.port(); }
+};
+
+LoadServer server;
+
+#define RELAY_COUNT 4
+
+static bool relaySet[ RELAY_COUNT];                         // relay state
+
+static void relayLine( char* line, int i)
+{
+  snprintf( line + strlen( line), 40, "# relay %02d on pin %02d = %s\r\n", i, i + 2, relaySet[ i] ? "on" : "off");
+}
+
+static void handleRelay_GET( RequestContext& request)
+{
+  char        reply[ 40 * RELAY_COUNT]; reply[0] = 0;
+  const char* index = request.param( "id");
+  long        relay = request.paramInt( "id");
+
+  if ( index) {
+    if ( relay >= 0 && relay < RELAY_COUNT) relayLine( reply, relay);
+  } else {
+    for ( int i = 0; i < RELAY_COUNT; i++) relayLine( reply, i);
+  }
+
+  request.respond( 200, "text/plain", reply);
+}
+
+static void handleRelay_PUT( RequestContext& request)
+{
+  const char* index = request.param( "id");
+  long        relay = request.paramInt( "id");
+  bool        state = request.arg( "state", "on");
+
+  for ( int i = 0; i < RELAY_COUNT; i++) {
+    if ( !index || i == relay) relaySet[ i] = state;
+  }
+
+  request.respond( 200);
+}
+
+// start relay server in child process (returns pid, port = bound port)
+static pid_t serverStart( uint16_t& port)
+{
+  server.begin();
+  server.handleOn( handleRelay_GET, "/relays"         , HTTP_GET);
+  server.handleOn( handleRelay_GET, "/relays/{id:int}", HTTP_GET);
+  server.handleOn( handleRelay_PUT, "/relays"         , HTTP_PUT);
+  server.handleOn( handleRelay_PUT, "/relays/{id:int}", HTTP_PUT);
+
+  port = server.boundPort();
+
+  pid_t pid = fork();
+
+  if ( pid == 0) {                                          // child = serve until killed
+    for (;;) server.handle();
+  }
+
+  return pid;
+}
+
+// load generator
+
+static uint16_t                       loadPort      = 0;    // server port
+static bool                           loadKeepAlive = true; // true = persistent sessions
+static int                            loadMix[ LOAD_MIX_SIZE];
+static int                            loadMixSize   = 0;    // entries in loadMix (index in requests)
+static int                            loadNext      = 0;    // next entry of loadMix
+static std::vector<unsigned long long> latency;             // latency of each completed request (ns)
+static unsigned long                  errors        = 0;    // failed requests
+
+// parse --mix argument (e.g. "identify,relays:2,put"), false = invalid
+static bool mixParse( char* text)
+{
+  loadMixSize = 0;
+
+  for ( char* item = strtok( text, ","); item; item = strtok( NULL, ",")) {
+    char*  weight = strchr( item, ':');
+    int    count  = 1;
+    size_t i;
+
+    if ( weight) { *weight++ = 0; count = atoi( weight); }
+
+    for ( i = 0; i < REQUEST_COUNT && strcmp( item, requests[ i].name); i++);
+
+    if ( i == REQUEST_COUNT || count < 1) return false;
+
+    while ( count-- && loadMixSize < LOAD_MIX_SIZE) loadMix[ loadMixSize++] = i;
+  }
+
+  return loadMixSize > 0;
+}
+
+// close client connection
+static void sessionClose( LoadSession& s)
+{
+  if ( s.fd >= 0) close( s.fd);
+
+  s.fd    = -1;
+  s.state = SESSION_IDLE;
+}
+
+// start next request of the mix (connects if needed)
+static void sessionStart( LoadSession& s)
+{
+  const LoadRequest& r = requests[ loadMix[ loadNext++ % loadMixSize]];
+
+  s.size  = snprintf( s.request, sizeof( s.request), "%s\r\nHost: 127.0.0.1\r\nConnection: %s\r\n\r\n",
+                      r.line, loadKeepAlive ? "keep-alive" : "close");
+  s.sent  = 0;
+  s.count = 0;
+  s.body  = false;
+  s.left  = 0;
+  s.close = !loadKeepAlive;
+  s.start = nanos();
+  s.state = SESSION_SENDING;
+
+  if ( s.fd >= 0) return;                                   // persistent session = send right away
+
+  struct sockaddr_in addr;
+  int                on = 1;
+
+  memset( &addr, 0, sizeof( addr));
+  addr.sin_family      = AF_INET;
+  addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK);
+  addr.sin_port        = htons( loadPort);
+
+  s.fd = socket( AF_INET, SOCK_STREAM, 0);
+  fcntl( s.fd, F_SETFL, fcntl( s.fd, F_GETFL, 0) | O_NONBLOCK);
+  setsockopt( s.fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof( on));
+
+  if ( connect( s.fd, (struct sockaddr*) &addr, sizeof( addr)) < 0) {
+    if ( errno != EINPROGRESS) { errors++; sessionClose( s); return; }
+    s.state = SESSION_CONNECTING;
+  }
+}
+
+// response complete = record latency, then close or keep session
+static void sessionDone( LoadSession& s)
+{
+  latency.push_back( nanos() - s.start);
+
+  if ( s.close) sessionClose( s);
+  else s.state = SESSION_IDLE;
+}
+
+// parse response header (false = not complete yet)
+static bool sessionHeader( LoadSession& s)
+{
+  s.buffer[ s.count] = 0;
+
+  char* end = strstr( s.buffer, "\r\n\r\n");
+
+  if ( !end) return false;
+
+  int code = ( s.count > 12) ? atoi( s.buffer + 9) : 0;
+
+  if ( code < 200 || code >= 400) errors++;                 // count error responses (latency still recorded)
+
+  s.left = -1;                                              // no Content-Length = body until close
+
+  for ( char* line = strstr( s.buffer, "\r\n"); line && line < end; line = strstr( line + 2, "\r\n")) {
+    if ( !strncasecmp( line + 2, "Content-Length:", 15)) s.left = atol( line + 17);
+    if ( !strncasecmp( line + 2, "Connection: close", 17)) s.close = true;
+  }
+
+  if ( code == 204 || code == 304) s.left = 0;
+
+  if ( s.left >= 0) s.left -= s.count - ( end + 4 - s.buffer);
+                                                            // body bytes already received
+  return true;
+}
+
+// progress session on poll events
+static void sessionEvent( LoadSession& s, short events)
+{
+  if ( s.state == SESSION_CONNECTING) {
+    int       error = 0;
+    socklen_t size  = sizeof( error);
+
+    getsockopt( s.fd, SOL_SOCKET, SO_ERROR, &error, &size);
+
+    if ( error) { errors++; sessionClose( s); return; }
+    s.state = SESSION_SENDING;
+  }
+
+  if ( s.state == SESSION_SENDING) {
+    ssize_t n = send( s.fd, s.request + s.sent, s.size - s.sent, MSG_NOSIGNAL);
+
+    if ( n < 0 && errno != EAGAIN) { errors++; sessionClose( s); return; }
+    if ( n > 0) s.sent += n;
+    if ( s.sent == s.size) s.state = SESSION_RECEIVING;
+    return;
+  }
+
+  if (( s.state == SESSION_RECEIVING) && ( events & ( POLLIN | POLLHUP | POLLERR))) {
+    char    data[ 4096];                                    // body data (counted, not stored)
+    ssize_t n;
+
+    if ( s.body) n = recv( s.fd, data, sizeof( data), 0);
+    else         n = recv( s.fd, s.buffer + s.count, LOAD_BUFFER_SIZE - 1 - s.count, 0);
+
+    if ( n < 0 && errno == EAGAIN) return;
+
+    if ( n <= 0) {                                          // session closed by server
+      if ( s.body && s.left < 0) { s.close = true; sessionDone( s); return; }
+      errors++;                                             // closed without (complete) response
+      sessionClose( s);
+      return;
+    }
+
+    if ( s.body) {
+      if ( s.left > 0) s.left -= n;
+    } else {
+      s.count += n;
+      if ( !sessionHeader( s)) {                            // header not complete (yet)
+        if ( s.count == LOAD_BUFFER_SIZE - 1) { errors++; sessionClose( s); }
+        return;
+      }
+      s.body = true;
+    }
+
+    if ( s.left == 0) sessionDone( s);
+  }
+}
+
+// return percentile (p = 0..1) of sorted latencies (us)
+static double percentile( double p)
+{
+  if ( latency.empty()) return 0;
+
+  size_t i = ( size_t) ( p * latency.size());
+
+  return latency[ std::min( i, latency.size() - 1)] / 1000.0;
+}
+
+int main( int argc, char** argv)
+{
+  int    concurrency = 4;
+  double duration    = 5;
+  bool   json        = false;
+  char   mix[ 128]   = "identify,relays,put";
+  char   mixText[ 128];                                     // --mix as given (mix is split by mixParse)
+  pid_t  child       = 0;
+
+  for ( int i = 1; i < argc; i++) {
+    bool more = i + 1 < argc;
+
+    if      ( !strcmp( argv[ i], "--json"       )        ) json        = true;
+    else if ( !strcmp( argv[ i], "--port"       ) && more) loadPort    = atoi( argv[ ++i]);
+    else if ( !strcmp( argv[ i], "--concurrency") && more) concurrency = atoi( argv[ ++i]);
+    else if ( !strcmp( argv[ i], "--duration"   ) && more) duration    = atof( argv[ ++i]);
+    else if ( !strcmp( argv[ i], "--keepalive"  ) && more) loadKeepAlive = strcmp( argv[ ++i], "off");
+    else if ( !strcmp( argv[ i], "--mix"        ) && more) snprintf( mix, sizeof( mix), "%s", argv[ ++i]);
+    else {
+      fprintf( stderr, "usage: %s [--port N] [--concurrency C] [--duration S] [--keepalive on|off]"
+                       " [--mix identify,relays,put[:weight]] [--json]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  strcpy( mixText, mix);
+  if ( !mixParse( mix) || concurrency < 1 || duration <= 0) {
+    fprintf( stderr, "invalid --mix / --concurrency / --duration\n");
+    return 1;
+  }
+
+  if ( !loadPort) child = serverStart( loadPort);           // no server given = start relay server
+
+  std::vector<LoadSession>   sessions( concurrency);
+  std::vector<struct pollfd> polls   ( concurrency);
+
+  for ( int i = 0; i < concurrency; i++) {                  // no sessions open (yet)
+    sessions[ i].fd    = -1;
+    sessions[ i].state = SESSION_IDLE;
+  }
+
+  latency.reserve( 1 << 20);
+
+  unsigned long long start = nanos();
+  unsigned long long end   = start + ( unsigned long long) ( duration * 1e9);
+
+  while ( nanos() < end) {
+    for ( int i = 0; i < concurrency; i++) {
+      LoadSession& s = sessions[ i];
+
+      if ( s.state == SESSION_IDLE) sessionStart( s);
+
+      polls[ i].fd      = s.fd;
+      polls[ i].events  = ( s.state == SESSION_RECEIVING) ? POLLIN : POLLOUT;
+      polls[ i].revents = 0;
+    }
+
+    if ( poll( polls.data(), concurrency, 100) <= 0) continue;
+
+    for ( int i = 0; i < concurrency; i++) {
+      if ( polls[ i].revents) sessionEvent( sessions[ i], polls[ i].revents);
+    }
+  }
+
+  double elapsed = ( nanos() - start) / 1e9;
+
+  for ( int i = 0; i < concurrency; i++) sessionClose( sessions[ i]);
+
+  if ( child > 0) { kill( child, SIGTERM); waitpid( child, NULL, 0); }
+
+  std::sort( latency.begin(), latency.end());
+
+  double rate = latency.size() / elapsed;
+
+  if ( json) {
+    printf( "{\"bench\":\"SimpleWebServerLoad\",\"concurrency\":%d,\"keepalive\":%s,\"mix\":\"%s\","
+            "\"duration_s\":%.2f,\"requests\":%zu,\"errors\":%lu,\"rps\":%.1f,"
+            "\"p50_us\":%.1f,\"p99_us\":%.1f,\"p999_us\":%.1f,\"max_us\":%.1f}\n",
+            concurrency, loadKeepAlive ? "true" : "false", mixText, elapsed, latency.size(), errors, rate,
+            percentile( 0.5), percentile( 0.99), percentile( 0.999), percentile( 1));
+  } else {
+    printf( "concurrency %d, keep-alive %s, mix %s, %.2f s\n", concurrency, loadKeepAlive ? "on" : "off", mixText, elapsed);
+    printf( "requests    %zu (errors %lu)\n", latency.size(), errors);
+    printf( "throughput  %.1f req/s\n", rate);
+    printf( "latency us  p50 %.1f  p99 %.1f  p999 %.1f  max %.1f\n",
+            percentile( 0.5), percentile( 0.99), percentile( 0.999), percentile( 1));
+  }
+
+  return 0;
+}
@@ -0,0 +1,263 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Linux (host build)
+// Library    : Simple WebServer Library for Arduino & ESP8266
+// File       : SimpleWebServerTest.cpp
+// Purpose    : regression test of request parser, router, response writer and cache (host build, ctest)
+// Repository : https://github.com/DennisB66/Simple-WebServer-Library-for-Arduino
+//
+// Usage: SimpleWebServerTest [-v]
+//
+// Each case sends fixed request data over an in-memory session, runs handle() until nothing changes and
+// compares the full response data (headers included) with the expected data. -v prints all responses.
+// Exit code 0 = all cases passed.
+
+#include "SimpleWebServer.h"
+
+#define TEST_HANDLE 32                                      // handle() calls per case (server never blocks)
+
+static const char appData[] PROGMEM = "var led = 1;\n";
+static const char appGzip[] PROGMEM = { 0x1f, ( char) 0x8b, 0x08, 0x00, 0x01, 0x02 };
+                                                            // gzip variant (content not checked)
+const SimpleWebAsset assets[] PROGMEM = {
+  HTTP_ASSET_GZIP( "/app.js", "application/javascript", appData, appGzip),
+};
+
+class SimpleWebServerTest : public SimpleWebServer          // server with in-memory transport
+{
+public:
+  SimpleWebServerTest() : SimpleWebServer( (char*) "Test") {}
+
+  void attach( MemorySession* session) { _server.attach( session); }
+};
+
+SimpleWebServerTest server;
+
+static bool        verbose = false;
+static int         failed  = 0;
+static char        relays[] = "0000";                       // relay states (0 = off, 1 = on)
+static int         relayCalls = 0;                          // calls of relay GET callback (cache check)
+static std::string body;                                    // received request body
+
+// GET "/relays" and "/relays/{id:int}" (as Simple_HTTP_Relay)
+static void handleRelayGet( RequestContext& request)
+{
+  char reply[ 16];
+
+  relayCalls++;
+  if ( request.param( "id")) snprintf( reply, sizeof( reply), "%c\r\n", relays[ request.paramInt( "id") & 3]);
+  else                       snprintf( reply, sizeof( reply), "%s\r\n", relays);
+
+  request.respond( 200, "text/plain", reply);
+}
+
+// PUT "/relays/{id:int}?state=on|off"
+static void handleRelayPut( RequestContext& request)
+{
+  relays[ request.paramInt( "id") & 3] = request.arg( "state", "on") ? '1' : '0';
+
+  request.respond( 200);
+  server.invalidate( "relays");                             // drop cached GET responses on "/relays"
+}
+
+// GET "/hello" (sketch style: header first, then content of unknown size)
+static void handleHello()
+{
+  server.respond( 200);
+  server.sendLine( "hello");
+}
+
+// POST "/upload", body arrives in blocks before the callback
+static void handleUploadBody( const char* data, size_t size)
+{
+  body.append( data, size);
+}
+
+static void handleUpload( RequestContext& request)
+{
+  char reply[ 16];
+
+  snprintf( reply, sizeof( reply), "%u\r\n", ( unsigned) body.size());
+  request.respond( 200, "text/plain", reply);
+}
+
+// return data with CR / LF visible (for failure reports)
+static std::string show( const std::string& data)
+{
+  std::string text;
+
+  for ( size_t i = 0; i < data.size(); i++) {
+    if      ( data[ i] == '\r') text += "\\r";
+    else if ( data[ i] == '\n') text += "\\n\n  ";
+    else                        text += data[ i];
+  }
+
+  return text;
+}
+
+// send request data over a new session, compare response data (name, request, expected response, ms before close)
+static void check( const char* name, const char* request, const std::string& expected, unsigned long wait = 0)
+{
+  std::string   output;
+  MemorySession session = { request, strlen( request), 0, 0, 0, true, &output, false};
+
+  server.attach( &session);
+  for ( int i = 0; i < TEST_HANDLE; i++) server.handle();   // serve all (pipelined) requests
+
+  if ( wait) {                                              // let server timers expire (e.g. read timeout)
+    delay( wait);
+    for ( int i = 0; i < TEST_HANDLE; i++) server.handle();
+  }
+
+  session.open = false;                                     // client closes = server releases slot
+  for ( int i = 0; i < TEST_HANDLE; i++) server.handle();
+  server.attach( NULL);
+
+  if ( output != expected) {
+    failed++;
+    printf( "FAIL %s\n  expected:\n  %s\n  received:\n  %s\n", name, show( expected).c_str(), show( output).c_str());
+  } else {
+    printf( "ok   %s\n", name);
+    if ( verbose) printf( "  %s\n", show( output).c_str());
+  }
+}
+
+// serve request data over a session without closing it (session, request, client send buffer full)
+static void open( MemorySession& session, const char* request, std::string& output, bool full)
+{
+  MemorySession open = { request, strlen( request), 0, 0, 0, true, &output, full};
+
+  session = open;
+  server.attach( &session);
+  for ( int i = 0; i < TEST_HANDLE; i++) server.handle();
+  server.attach( NULL);
+}
+
+// check a condition (name, result)
+static void check( const char* name, bool result)
+{
+  if ( !result) failed++;
+  printf( "%s %s\n", result ? "ok  " : "FAIL", name);
+}
+
+#define TEXT_200( SIZE, KEEP) "HTTP/1.1 200 OK\r\nUser-Agent: Arduino-ethernet\r\nContent-Type: text/plain\r\n" \
+                              "Content-Length: " SIZE "\r\nConnection: " KEEP "\r\n\r\n"
+
+#define ASSET_200( SIZE, ETAG, GZIP) "HTTP/1.1 200 OK\r\nUser-Agent: Arduino-ethernet\r\nContent-Type: application/javascript\r\n" \
+                                     "Content-Length: " SIZE "\r\nETag: \"" ETAG "\"\r\n" GZIP \
+                                     "Vary: Accept-Encoding\r\nConnection: close\r\n\r\n"
+
+int main( int argc, char** argv)
+{
+  verbose = ( argc > 1) && !strcmp( argv[ 1], "-v");
+
+  server.begin();
+  server.handleOn( handleRelayGet, "/relays"         , HTTP_GET);
+  server.handleOn( handleRelayGet, "/relays/{id:int}", HTTP_GET);
+  server.handleOn( handleRelayPut, "/relays/{id:int}", HTTP_PUT);
+  server.handleOn( handleUpload  , "/upload"         , HTTP_POST, handleUploadBody);
+  server.handleOn( handleHello   , "/hello"          , HTTP_GET);
+  server.serveStatic( assets);
+  server.firstMatch();
+  server.cache( 1024);
+
+  check( "pipelined GET",
+         "GET /relays HTTP/1.1\r\n\r\nGET /relays/1 HTTP/1.1\r\n\r\nGET /relays/2 HTTP/1.1\r\nConnection: close\r\n\r\n",
+         TEXT_200( "6", "keep-alive") "0000\r\n"
+         TEXT_200( "3", "keep-alive") "0\r\n"
+         TEXT_200( "3", "close"     ) "0\r\n");
+
+  check( "empty line before request line",
+         "\r\nGET /relays/3 HTTP/1.1\r\nConnection: close\r\n\r\n",
+         TEXT_200( "3", "close") "0\r\n");
+
+  check( "chunked POST + pipelined GET",
+         "POST /upload HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+         "5\r\nhello\r\n7;ext=1\r\n, world\r\n0\r\nTrailer: x\r\n\r\n"
+         "GET /relays/0 HTTP/1.1\r\nConnection: close\r\n\r\n",
+         TEXT_200( "4", "keep-alive") "12\r\n"
+         TEXT_200( "3", "close"     ) "0\r\n");
+  check( "chunked POST body", body == "hello, world");
+
+  check( "404 unknown path",
+         "GET /lights HTTP/1.1\r\nConnection: close\r\n\r\n",
+         "HTTP/1.1 404 Not Found\r\nUser-Agent: Arduino-ethernet\r\nContent-Type: text/html\r\n"
+         "Content-Length: 0\r\nConnection: close\r\n\r\n");
+
+  check( "405 with Allow",
+         "DELETE /relays/1 HTTP/1.1\r\nConnection: close\r\n\r\n",
+         "HTTP/1.1 405 Method Not Allowed\r\nUser-Agent: Arduino-ethernet\r\nContent-Type: text/html\r\n"
+         "Content-Length: 0\r\nAllow: GET, PUT\r\nConnection: close\r\n\r\n");
+
+  check( "respond( 200) + sendLine()",
+         "GET /hello HTTP/1.1\r\n\r\nGET /relays/1 HTTP/1.1\r\n\r\n",
+         "HTTP/1.1 200 OK\r\nUser-Agent: Arduino-ethernet\r\nContent-Type: text/html\r\n"
+         "Connection: close\r\n\r\nhello\r\n\r\n");          // no size = content ends at session close
+
+  check( "new session times out in same slot",
+         "", "", HTTP_READ_TIMEOUT + 100);                  // nothing left of previous response (e.g. CR/LF)
+
+  check( "respond( 200) without content",
+         "PUT /relays/1?state=off HTTP/1.1\r\nContent-Length: 0\r\n\r\nGET /relays/1 HTTP/1.1\r\nConnection: close\r\n\r\n",
+         "HTTP/1.1 200 OK\r\nUser-Agent: Arduino-ethernet\r\nContent-Type: text/html\r\n"
+         "Content-Length: 0\r\nConnection: keep-alive\r\n\r\n"
+         TEXT_200( "3", "close") "0\r\n");
+
+  check( "asset",
+         "GET /app.js HTTP/1.1\r\nConnection: close\r\n\r\n",
+         ASSET_200( "13", "87f6a25f", "") "var led = 1;\n");
+
+  check( "asset gzip",
+         "GET /app.js HTTP/1.1\r\nAccept-Encoding: deflate, gzip;q=0.5\r\nConnection: close\r\n\r\n",
+         ASSET_200( "6", "07f6a25f", "Content-Encoding: gzip\r\n") + std::string( appGzip, sizeof( appGzip)));
+
+  check( "asset 304",
+         "GET /app.js HTTP/1.1\r\nIf-None-Match: \"87f6a25f\"\r\nConnection: close\r\n\r\n",
+         "HTTP/1.1 304 Not Modified\r\nUser-Agent: Arduino-ethernet\r\nContent-Type: application/javascript\r\n"
+         "ETag: \"87f6a25f\"\r\nVary: Accept-Encoding\r\nConnection: close\r\n\r\n");
+
+  MemorySession slow;                                       // client not reading its response
+  std::string   slowOutput;
+
+  open( slow, "GET /relays/1 HTTP/1.1\r\n\r\n", slowOutput, true);
+  check( "response to slow client kept in its slot",
+         "GET /relays/2 HTTP/1.1\r\nConnection: close\r\n\r\n",
+         TEXT_200( "3", "close") "0\r\n");                    // other slots are served meanwhile
+  slow.full = false;
+  for ( int i = 0; i < TEST_HANDLE; i++) server.handle();   // slow client reads = rest is sent
+  slow.open = false;
+  for ( int i = 0; i < TEST_HANDLE; i++) server.handle();
+  check( "response to slow client", slowOutput == TEXT_200( "3", "keep-alive") "0\r\n");
+
+  size_t used = server.routeArena().used();
+
+  server.serveStatic( assets);                              // same table again = content hashes reused
+  check( "serveStatic() again without arena use", server.routeArena().used() == used);
+  check( "asset after serveStatic() again",
+         "GET /app.js HTTP/1.1\r\nIf-None-Match: \"87f6a25f\"\r\nConnection: close\r\n\r\n",
+         "HTTP/1.1 304 Not Modified\r\nUser-Agent: Arduino-ethernet\r\nContent-Type: application/javascript\r\n"
+         "ETag: \"87f6a25f\"\r\nVary: Accept-Encoding\r\nConnection: close\r\n\r\n");
+
+  server.invalidate();                                      // start with empty cache
+
+  int calls = relayCalls;
+
+  check( "cache miss",
+         "GET /relays HTTP/1.1\r\nConnection: close\r\n\r\n",
+         TEXT_200( "6", "close") "0000\r\n");
+  check( "cache hit",
+         "GET /relays HTTP/1.1\r\nConnection: close\r\n\r\n",
+         TEXT_200( "6", "close") "0000\r\n");
+  check( "cache hit without callback", relayCalls == calls + 1);
+
+  check( "PUT invalidates cache",
+         "PUT /relays/2?state=on HTTP/1.1\r\nContent-Length: 0\r\nConnection: close\r\n\r\n",
+         "HTTP/1.1 200 OK\r\nUser-Agent: Arduino-ethernet\r\nContent-Type: text/html\r\n"
+         "Content-Length: 0\r\nConnection: close\r\n\r\n");
+  check( "cache refilled",
+         "GET /relays HTTP/1.1\r\nConnection: close\r\n\r\n",
+         TEXT_200( "6", "close") "0010\r\n");
+  check( "cache refilled by callback", relayCalls == calls + 2);
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,223 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Linux (host build)
+// Library    : Simple WebServer Library for Arduino & ESP8266
+// File       : SimplePosixTransport.cpp
+// Purpose    : non-blocking BSD socket transport to run SimpleWebServer natively (see SimpleTransport.h)
+// Repository : https://github.com/DennisB66/Simple-WebServer-Library-for-Arduino
+
+#include <Arduino.h>
+#include "SimpleTransport.h"
+
+#if defined(HTTP_TRANSPORT_POSIX)                           // only compiled for host builds
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+// create client (socket, -1 = no client)
+PosixClient::PosixClient( int fd)
+: _fd ( fd)
+, _eof( false)
+{
+}
+
+// return number of bytes ready to read (detects a closed session when none)
+int PosixClient::available()
+{
+  int size = 0;
+
+  if ( _fd < 0 || _eof) return 0;
+
+  if ( ioctl( _fd, FIONREAD, &size) < 0) { _eof = true; return 0; }
+
+  if ( size == 0) {                                         // no data = check if peer closed session
+    char c;
+    int  n = recv( _fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+
+    if ( n == 0 || ( n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) _eof = true;
+    if ( n >  0) size = n;
+  }
+
+  return size;
+}
+
+// read single byte (-1 = none)
+int PosixClient::read()
+{
+  uint8_t c;
+
+  return ( read( &c, 1) == 1) ? c : -1;
+}
+
+// read available bytes (-1 = none)
+int PosixClient::read( uint8_t* data, size_t size)
+{
+  if ( _fd < 0 || _eof) return -1;
+
+  ssize_t n = recv( _fd, data, size, MSG_DONTWAIT);
+
+  if ( n == 0 || ( n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) _eof = true;
+
+  return ( n > 0) ? n : -1;
+}
+
+// return next byte without reading (-1 = none)
+int PosixClient::peek()
+{
+  uint8_t c;
+
+  if ( _fd < 0 || _eof) return -1;
+
+  return ( recv( _fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1) ? c : -1;
+}
+
+// send single byte
+size_t PosixClient::write( uint8_t c)
+{
+  return write( &c, 1);
+}
+
+// send block without blocking (returns bytes sent, less than size = socket send buffer full)
+size_t PosixClient::write( const uint8_t* data, size_t size)
+{
+  size_t sent = 0;
+
+  while (( _fd >= 0) && !_eof && ( sent < size)) {
+    ssize_t n = send( _fd, data + sent, size - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+    if ( n > 0) { sent += n; continue; }
+
+    if ( n < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                                                            // send buffer full = caller retries later
+    if ( n < 0 && errno == EINTR) continue;
+
+    _eof = true;                                            // peer gone
+  }
+
+  return sent;
+}
+
+// no buffering (TCP_NODELAY is set)
+void PosixClient::flush()
+{
+}
+
+// close socket
+void PosixClient::stop()
+{
+  if ( _fd >= 0) close( _fd);
+
+  _fd  = -1;
+  _eof = true;
+}
+
+// true = session open (or unread data left)
+uint8_t PosixClient::connected()
+{
+  return ( _fd >= 0) && !_eof;
+}
+
+// true = valid socket
+PosixClient::operator bool()
+{
+  return _fd >= 0;
+}
+
+// true = same socket
+bool PosixClient::operator==( const PosixClient& client)
+{
+  return _fd == client._fd;
+}
+
+// true = other socket
+bool PosixClient::operator!=( const PosixClient& client)
+{
+  return _fd != client._fd;
+}
+
+// return socket
+int PosixClient::fd()
+{
+  return _fd;
+}
+
+// create server (port, 0 = any free port)
+PosixServer::PosixServer( uint16_t port)
+: _port( port)
+, _fd  ( -1)
+{
+}
+
+PosixServer::~PosixServer()
+{
+  end();
+}
+
+// bind and listen (non-blocking)
+void PosixServer::begin()
+{
+  struct sockaddr_in addr;
+  socklen_t          size = sizeof( addr);
+  int                on   = 1;
+
+  end();
+
+  _fd = socket( AF_INET, SOCK_STREAM, 0);
+
+  if ( _fd < 0) { perror( "PosixServer: socket"); return; }
+
+  setsockopt( _fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof( on));
+
+  memset( &addr, 0, sizeof( addr));
+  addr.sin_family      = AF_INET;
+  addr.sin_addr.s_addr = htonl( INADDR_ANY);
+  addr.sin_port        = htons( _port);
+
+  if (( bind( _fd, (struct sockaddr*) &addr, sizeof( addr)) < 0) || ( listen( _fd, SOMAXCONN) < 0)) {
+    perror( "PosixServer: bind / listen");
+    end();
+    return;
+  }
+
+  fcntl( _fd, F_SETFL, fcntl( _fd, F_GETFL, 0) | O_NONBLOCK);
+
+  if ( getsockname( _fd, (struct sockaddr*) &addr, &size) == 0) _port = ntohs( addr.sin_port);
+}
+
+// accept new client (false = none waiting)
+PosixClient PosixServer::available()
+{
+  int on = 1;
+
+  if ( _fd < 0) return PosixClient();
+
+  int fd = accept( _fd, NULL, NULL);
+
+  if ( fd < 0) return PosixClient();                        // no pending connection
+
+  fcntl( fd, F_SETFL, fcntl( fd, F_GETFL, 0) | O_NONBLOCK);
+  setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof( on));
+                                                            // one write per response = no need to wait for ACK
+  return PosixClient( fd);
+}
+
+// return bound port (after begin)
+uint16_t PosixServer::port()
+{
+  return _port;
+}
+
+// close listening socket
+void PosixServer::end()
+{
+  if ( _fd >= 0) close( _fd);
+
+  _fd = -1;
+}
+
+#endif
@@ -0,0 +1,57 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Linux (host build)
+// Library    : Simple WebServer Library for Arduino & ESP8266
+// File       : SimplePosixTransport.h
+// Purpose    : non-blocking BSD socket transport to run SimpleWebServer natively (see SimpleTransport.h)
+// Repository : https://github.com/DennisB66/Simple-WebServer-Library-for-Arduino
+
+#ifndef _SIMPLE_POSIX_TRANSPORT_H
+#define _SIMPLE_POSIX_TRANSPORT_H
+
+#include <Arduino.h>
+
+class PosixClient : public Print                            // client session (non-blocking TCP socket)
+{
+public:
+  PosixClient( int = -1);                                   // create client (socket, -1 = no client)
+
+  int     available();                                      // return number of bytes ready to read
+  int     read();                                           // read single byte (-1 = none)
+  int     read( uint8_t*, size_t);                          // read available bytes (-1 = none)
+  int     peek();                                           // return next byte without reading (-1 = none)
+  size_t  write( uint8_t);                                  // send single byte
+  size_t  write( const uint8_t*, size_t);                   // send block (never waits, short count = send buffer full)
+  using   Print::write;
+  void    flush();                                          // no buffering (TCP_NODELAY is set)
+  void    stop();                                           // close socket
+  uint8_t connected();                                      // true = session open (or unread data left)
+
+  operator bool();                                          // true = valid socket
+  bool operator==( const PosixClient&);                     // true = same socket
+  bool operator!=( const PosixClient&);                     // true = other socket
+
+  int     fd();                                             // return socket
+
+protected:
+  int     _fd;                                              // socket (-1 = closed)
+  bool    _eof;                                             // true = peer closed session (or socket error)
+};
+
+class PosixServer                                           // listening socket (non-blocking accept)
+{
+public:
+  PosixServer( uint16_t);                                   // create server (port, 0 = any free port)
+  ~PosixServer();
+
+  void        begin();                                      // bind and listen
+  PosixClient available();                                  // accept new client (false = none waiting)
+  uint16_t    port();                                       // return bound port (after begin)
+  void        end();                                        // close listening socket
+
+protected:
+  uint16_t    _port;                                        // port number
+  int         _fd;                                          // listening socket (-1 = closed)
+};
+
+#endif
@@ -0,0 +1,55 @@
+// Copyright  : Dennis Buis (2017)
+// License    : MIT
+// Platform   : Arduino / ESP8266 / Linux
+// Library    : Simple WebServer Library for Arduino & ESP8266
+// File       : SimpleTransport.h
+// Purpose    : select the server / client classes used by SimpleWebServer
+// Repository : https://github.com/DennisB66/Simple-WebServer-Library-for-Arduino
+//
+// A transport is a pair of classes with the interface of EthernetServer / EthernetClient:
+//
+//   server( uint16_t port)            // create server on port
+//   void     begin()                  // start listening
+//   client   available()              // return client with pending data or new connection (false = none)
+//
+//   int      available()              // number of bytes ready to read (no blocking)
+//   int      read( uint8_t*, size_t)  // read available bytes (-1 / 0 = none)
+//   size_t   write( const uint8_t*, size_t)
+//   uint8_t  connected()              // true = session open (or unread data left)
+//   void     flush()                  // wait until written data has been sent
+//   void     stop()                   // close session
+//   operator bool()                   // true = valid client
+//   bool     operator==( client&)     // true = same session
+//
+// A custom transport (e.g. in-memory for benchmarks) is set by defining
+// HTTP_TRANSPORT_SERVER and HTTP_TRANSPORT_CLIENT (and HTTP_TRANSPORT_INCLUDE,
+// the header declaring both classes) for all files of the build.
+
+#ifndef _SIMPLE_TRANSPORT_H
+#define _SIMPLE_TRANSPORT_H
+
+#if   defined(HTTP_TRANSPORT_SERVER)                        // custom transport
+#ifdef HTTP_TRANSPORT_INCLUDE
+#include HTTP_TRANSPORT_INCLUDE
+#endif
+#elif defined(__AVR__)
+#include <SPI.h>
+#include <Ethernet.h>
+#define HTTP_TRANSPORT_SERVER EthernetServer                // server object (Ethernet based)
+#define HTTP_TRANSPORT_CLIENT EthernetClient                // client object (Ethernet based)
+#elif defined(ESP8266)
+#include <ESP8266WiFi.h>
+#define HTTP_TRANSPORT_SERVER WiFiServer                    // server object (WiFi based)
+#define HTTP_TRANSPORT_CLIENT WiFiClient                    // client object (WiFi based)
+#elif defined(HTTP_TRANSPORT_POSIX) || ( !defined(ARDUINO) && defined(__unix__))
+#ifndef HTTP_TRANSPORT_POSIX
+#define HTTP_TRANSPORT_POSIX
+#endif
+#include "SimplePosixTransport.h"
+#define HTTP_TRANSPORT_SERVER PosixServer                   // server object (BSD socket based, host build)
+#define HTTP_TRANSPORT_CLIENT PosixClient                   // client object (BSD socket based, host build)
+#else
+#error "SimpleWebServer: no transport for this platform (define HTTP_TRANSPORT_SERVER / HTTP_TRANSPORT_CLIENT)"
+#endif
+
+#endif
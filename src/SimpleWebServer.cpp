@@ -22,470 +22,2534 @@
 #define SERVER_HTTP_INIT  9                                 // state engine http version read loop
 #define SERVER_HTTP_LOOP 10                                 // state engine http version read done
 #define SERVER_HTTP_DONE 11                                 // state engine http version read done
-#define HTTP_REQUEST_ERR 12                                 // state engine invalid request
+#define SERVER_HEAD_INIT 12                                 // state engine header line read init
+#define SERVER_HEAD_LOOP 13                                 // state engine header line read loop
+#define SERVER_HEAD_LAST 14                                 // state engine empty header line read
+#define SERVER_HEAD_DONE 15                                 // state engine header read done (request complete)
+#define HTTP_REQUEST_ERR 16                                 // state engine invalid request
+
+#define PARSE_NEED_MORE   0                                 // parser result: request incomplete
+#define PARSE_COMPLETE    1                                 // parser result: request complete
+#define PARSE_ERROR       2                                 // parser result: invalid request
+
+#define CLIENT_ACCEPTING  0                                 // connection state: waiting for client
+#define CLIENT_READING    1                                 // connection state: receiving request
+#define CLIENT_BODY       2                                 // connection state: receiving request body
+#define CLIENT_PARSED     3                                 // connection state: request available
+#define CLIENT_RESPONDING 4                                 // connection state: handling request
+#define CLIENT_CLOSING    5                                 // connection state: closing session
+#define CLIENT_SENDING    6                                 // connection state: sending rest of response
+
+#define BODY_NONE         0                                 // body state: no (more) body data
+#define BODY_DATA         1                                 // body state: body data (Content-Length)
+#define BODY_SIZE         2                                 // body state: chunk size line
+#define BODY_EXTN         3                                 // body state: chunk extension
+#define BODY_CHUNK        4                                 // body state: chunk data
+#define BODY_NEXT         5                                 // body state: end of chunk data
+#define BODY_TRAIL        6                                 // body state: trailer lines
+#define BODY_ERROR        7                                 // body state: invalid chunk encoding
+
+#define ROUTE_TEXT        0                                 // route node: literal path item
+#define ROUTE_INT         1                                 // route node: integer parameter ({label:int})
+#define ROUTE_STR         2                                 // route node: string parameter  ({label})
+
+#define CPRINT(S) _write(S);                                // add to response buffer (sent by _flush)
+
+#if HTTP_CHUNK_SIZE
+#define CHUNK_BLOCK       HTTP_CHUNK_SIZE                   // size of body blocks / FLASH copies
+#else
+#define CHUNK_BLOCK       16                                // no staging area = small blocks on stack
+#endif
+
+#if ( HTTP_OUTPUT_SIZE >= 16) && ( HTTP_OUTPUT_SIZE <= 0xFFFF)
+#define FRAME_OUTPUT      1                                 // chunks framed in response buffer (e.g. metrics)
+#else
+#define FRAME_OUTPUT      0                                 // no (or too large) response buffer = chunk path
+#endif
+#define FRAME_HEAD        6                                 // size line of framed chunk ("hhhh\r\n")
+#define FRAME_TAIL        2                                 // end of framed chunk ("\r\n")
+
+static const HTTPMethod methodList[] = { HTTP_GET, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+static const char       methodName[] PROGMEM = "GET\0POST\0PUT\0PATCH\0DELETE\0OPTIONS";
+                                                            // supported methods (names in same order)
+#define METHOD_BIT(M) ( 1 << (M))                           // bit of method in method mask
 
 int returnCode = 400;                                       // HTTP response code (default = ERROR)
 
+static const uint16_t headerList[] PROGMEM = { HTTP_HEADER_LIST };
+                                                            // hashes of request headers kept in header index
+
+#define HEADER_BLOCK( CODE, MESSAGE, TYPE) "HTTP/1.1 " #CODE " " MESSAGE "\r\n" \
+                                           "User-Agent: Arduino-ethernet\r\n" \
+                                           "Content-Type: " TYPE "\r\n"
+                                                            // prebuilt response header (status line + fixed headers)
+#define HEADER_HTML       0                                 // header block type: text/html
+#define HEADER_TEXT       1                                 // header block type: text/plain
+#define HEADER_JSON       2                                 // header block type: application/json
+
+static const char typeName[] PROGMEM = "text/html\0text/plain\0application/json";
+                                                            // content types with header blocks (names in same order)
+static const char header200Html[] PROGMEM = HEADER_BLOCK( 200, "OK"                   , "text/html");
+static const char header200Text[] PROGMEM = HEADER_BLOCK( 200, "OK"                   , "text/plain");
+static const char header200Json[] PROGMEM = HEADER_BLOCK( 200, "OK"                   , "application/json");
+static const char header400Html[] PROGMEM = HEADER_BLOCK( 400, "Bad Request"          , "text/html");
+static const char header404Html[] PROGMEM = HEADER_BLOCK( 404, "Not Found"            , "text/html");
+static const char header405Html[] PROGMEM = HEADER_BLOCK( 405, "Method Not Allowed"   , "text/html");
+static const char header500Html[] PROGMEM = HEADER_BLOCK( 500, "Internal Server Error", "text/html");
+static const char header501Html[] PROGMEM = HEADER_BLOCK( 501, "Not Implemented"      , "text/html");
+
+struct headerBlock {
+  uint16_t code;                                            // response code
+  uint8_t  type;                                            // content type (HEADER_HTML, ...)
+  uint8_t  size;                                            // size of header block
+  PGM_P    block;                                           // header block (in FLASH)
+};
+
+#define HEADER_ENTRY( CODE, TYPE, BLOCK) { CODE, TYPE, sizeof( BLOCK) - 1, BLOCK }
+
+static const headerBlock headerBlocks[] PROGMEM = {         // prebuilt headers for common responses
+  HEADER_ENTRY( 200, HEADER_HTML, header200Html),
+  HEADER_ENTRY( 200, HEADER_TEXT, header200Text),
+  HEADER_ENTRY( 200, HEADER_JSON, header200Json),
+  HEADER_ENTRY( 400, HEADER_HTML, header400Html),
+  HEADER_ENTRY( 404, HEADER_HTML, header404Html),
+  HEADER_ENTRY( 405, HEADER_HTML, header405Html),
+  HEADER_ENTRY( 500, HEADER_HTML, header500Html),
+  HEADER_ENTRY( 501, HEADER_HTML, header501Html),
+};
+
 // create Webserver task (for a specfic method)
-SimpleWebServerTask::SimpleWebServerTask( TaskFunc func, const char* device, HTTPMethod method)
+SimpleWebServerTask::SimpleWebServerTask( TaskFunc func, const char* device, HTTPMethod method, SimpleArena& arena, BodyFunc body)
 : SimpleTask( func)
 , _device( NULL)
+, _hash  ( 0)
+, _method( method)
+, _context( NULL)
+, _body  ( body)
+{
+  _init( device, arena);                                    // store device
+}
+
+// create Webserver task with request context callback (for a specfic method)
+SimpleWebServerTask::SimpleWebServerTask( ContextFunc func, const char* device, HTTPMethod method, SimpleArena& arena, BodyFunc body)
+: SimpleTask( NULL)
+, _device( NULL)
+, _hash  ( 0)
 , _method( method)
+, _context( func)
+, _body  ( body)
+{
+  _init( device, arena);                                    // store device
+}
+
+// store targeted device (device, arena for device copy, arena full = device NULL)
+void SimpleWebServerTask::_init( const char* device, SimpleArena& arena)
 {
   if ( device) {                                            // create device string
-    _device = (char*)  malloc( sizeof( char) * ( strlen( device) + 1));
-    strcpy( _device, device);                               // copy device value
+    _device = arena.copy( device);                          // copy device value (in arena)
+    _hash   = HTTP_Hash( device);                           // precompute device hash
+  }
+}
+
+// return targeted device
+const char* SimpleWebServerTask::device()
+{
+  return _device;                                           // return device
+}
+
+// return hash of targeted device
+uint16_t SimpleWebServerTask::hash()
+{
+  return _hash;                                             // return hash
+}
+
+// return targeted method
+HTTPMethod SimpleWebServerTask::method()
+{
+  return _method;                                           // return method
+}
+
+// return context callback (NULL = TaskFunc callback)
+ContextFunc SimpleWebServerTask::context()
+{
+  return _context;                                          // return context callback
+}
+
+// return request body callback (NULL = onBody callback)
+BodyFunc SimpleWebServerTask::body()
+{
+  return _body;                                             // return body callback
+}
+
+// create arena on fixed memory (memory, size)
+SimpleArena::SimpleArena( char* memory, size_t size)
+: _memory( memory)
+, _size  ( size)
+, _used  ( 0)
+, _peak  ( 0)
+, _failed( 0)
+{
+}
+
+// allocate memory (aligned for pointers), NULL = arena full
+void* SimpleArena::alloc( size_t size)
+{
+  size_t skip = -(uintptr_t) ( _memory + _used) & ( sizeof( void*) - 1);
+                                                            // padding to next aligned address
+  if ( _used + skip + size > _size) {                       // arena full
+    _failed++;
+    return NULL;
+  }
+
+  void* memory = _memory + _used + skip;
+
+  _used += skip + size;                                     // bump
+  if ( _used > _peak) _peak = _used;                        // track high-water mark
+
+  return memory;
+}
+
+// allocate copy of string (string, length), NULL = arena full
+char* SimpleArena::copy( const char* text, size_t size)
+{
+  char* item = (char*) alloc( size + 1);
+
+  if ( item) {
+    memcpy( item, text, size);                              // copy string
+    item[ size] = 0;
+  }
+
+  return item;
+}
+
+// allocate copy of string, NULL = arena full
+char* SimpleArena::copy( const char* text)
+{
+  return text ? copy( text, strlen( text)) : NULL;
+}
+
+// release all allocations (high-water mark is kept)
+void SimpleArena::reset()
+{
+  _used = 0;
+}
+
+size_t SimpleArena::size()   { return _size; }
+size_t SimpleArena::used()   { return _used; }
+size_t SimpleArena::peak()   { return _peak; }
+size_t SimpleArena::failed() { return _failed; }
+
+// create request context (server, connection slot)
+RequestContext::RequestContext( SimpleWebServerCore& server, uint8_t slot)
+: _server( server)
+, _slot  ( slot)
+{
+}
+
+// make slot the active connection of server (all calls below act on this request)
+SimpleWebServerCore& RequestContext::_select()
+{
+  _server._conn = _server._conns + _slot;                   // active connection = request of context
+  return _server;
+}
+
+HTTPMethod  RequestContext::method()                                   { return _select().method(); }
+bool        RequestContext::method( HTTPMethod method)                 { return _select().method( method); }
+int         RequestContext::pathCount()                                { return _select().pathCount(); }
+const char* RequestContext::path( uint8_t i)                           { return _select().path( i); }
+bool        RequestContext::path( uint8_t i, const char* item)         { return _select().path( i, item); }
+int         RequestContext::argsCount()                                { return _select().argsCount(); }
+const char* RequestContext::arg( const char* label)                    { return _select().arg( label); }
+bool        RequestContext::arg( const char* label, const char* value) { return _select().arg( label, value); }
+const char* RequestContext::header( const char* label)                 { return _select().header( label); }
+const char* RequestContext::param( const char* label)                  { return _select().param( label); }
+long        RequestContext::paramInt( const char* label)               { return _select().paramInt( label); }
+
+// return response code
+int RequestContext::status()
+{
+  return _select()._conn->status;
+}
+
+// set response code (sent after callback if no response was sent yet)
+void RequestContext::status( int code)
+{
+  _select()._conn->status = code;
+}
+
+void RequestContext::respond( int code)                                          { _select().respond( code); }
+void RequestContext::respond( int code, const char* type, size_t size)           { _select().respond( code, type, size); }
+void RequestContext::respond( int code, const char* type, const char* content)   { _select().respond( code, type, content); }
+void RequestContext::sendContent( const char* content)                           { _select().sendContent( content); }
+void RequestContext::sendLine( const char* label, const char* value)             { _select().sendLine( label, value); }
+void RequestContext::sendLine( const __FlashStringHelper* label, const char* value) { _select().sendLine( label, value); }
+void RequestContext::beginChunked( int code, const char* type)                   { _select().beginChunked( code, type); }
+void RequestContext::writeChunk( const char* data, size_t size)                  { _select().writeChunk( data, size); }
+void RequestContext::writeChunk( const char* content)                            { _select().writeChunk( content); }
+void RequestContext::endChunked()                                                { _select().endChunked(); }
+
+// response content stream (Print interface of server, bound to this request)
+Print& RequestContext::stream()
+{
+  return _select();
+}
+
+// allocate request scratch memory (released after the request), NULL = arena full
+void* RequestContext::scratch( size_t size)
+{
+  return _server._scratchArena.alloc( size);
+}
+
+// allocate request scratch copy of string (released after the request), NULL = arena full
+char* RequestContext::scratch( const char* text)
+{
+  return _server._scratchArena.copy( text);
+}
+
+// create server core (default port = 80), slots are attached by BasicWebServer
+SimpleWebServerCore::SimpleWebServerCore( char* name, int port)
+: SimpleTaskList()
+, _name  ( name)
+, _port  ( port)
+, _server( port)
+, _routes( NULL)
+, _routeCount( 0)
+, _assets( NULL)
+, _assetCount( 0)
+, _assetTags( NULL)
+, _assetRoom( 0)
+, _firstMatch( false)
+, _outputCount( 0)
+, _frameAt( HTTP_SIZE_UNKNOWN)
+, _sending( NULL)
+, _bodyFunc( NULL)
+, _chunkCount( 0)
+#if HTTP_ROUTE_ARENA
+, _routeArena( _routeMemory, sizeof( _routeMemory))
+#else
+, _routeArena( NULL, 0)                                     // no route arena (route tables only)
+#endif
+#if HTTP_SCRATCH_SIZE
+, _scratchArena( _scratchMemory, sizeof( _scratchMemory))
+#else
+, _scratchArena( NULL, 0)                                   // no scratch arena (scratch() = NULL)
+#endif
+, _cacheList( NULL)
+, _cacheBudget( 0)
+, _cacheUsed( 0)
+, _cacheNew( NULL)
+, _cacheCount( 0)
+, _cacheMax( 0)
+, _cacheOn( false)
+#if HTTP_METRICS_ROUTES
+, _metricsPath( NULL)
+, _metricsRouteCount( 0)
+, _metricsStatusCount( 0)
+, _metricsBytesIn( 0)
+, _metricsBytesOut( 0)
+, _metricsErrors( 0)
+, _metricsLabel( NULL)
+, _metricsFlash( false)
+, _metricsStart( 0)
+#endif
+, _conns ( NULL)
+, _conn  ( NULL)
+, _next  ( 0)
+, _connCount ( 0)
+, _bufferSize( 0)
+, _maxPath   ( 0)
+, _maxArgs   ( 0)
+{
+  _routeRoot.label = NULL;                                  // empty route trie
+  _routeRoot.type  = ROUTE_TEXT;
+  _routeRoot.child = NULL;
+  _routeRoot.next  = NULL;
+  _routeRoot.funcs = NULL;
+
+#if HTTP_METRICS_ROUTES                                     // clear other routes / codes (others cleared on first use)
+  memset( _metricsRoutes + HTTP_METRICS_ROUTES, 0, sizeof( metricsRoute));
+  memset( _metricsStatus + HTTP_METRICS_STATUS, 0, sizeof( metricsStatus));
+#endif
+}
+
+// attach slot storage (slots, number of slots, request buffer size, max path items, max arguments)
+void SimpleWebServerCore::_setup( connection* conns, uint8_t count, uint16_t bufferSize, uint8_t maxPath, uint8_t maxArgs)
+{
+  _conns      = conns;
+  _conn       = conns;
+  _connCount  = count;
+  _bufferSize = bufferSize;
+  _maxPath    = maxPath;
+  _maxArgs    = maxArgs;
+
+  for ( int i = 0; i < _connCount; i++) {                   // all slots start idle
+    _conns[ i].state   = CLIENT_ACCEPTING;
+    _conns[ i].header  = false;
+    _conns[ i].content = false;
+    _conns[ i].newline = false;
+    _conns[ i].chunked = false;
+  }
+}
+
+// start webserver
+void SimpleWebServerCore::begin()
+{
+  _server.begin();                                          // ethernet server begin
+}
+
+// return server name
+char* SimpleWebServerCore::name()
+{
+  return _name;                                             // return name
+}
+
+// return server port number
+word SimpleWebServerCore::port()
+{
+  return _port;                                             // return port
+}
+
+// check on incoming connection (true = HTTP request received, never blocks)
+bool SimpleWebServerCore::connect()
+{
+  if ( _sending) {                                          // response buffer still holds a response
+    _advance( _sending);                                    // continue sending it (without blocking)
+    if ( _sending) return false;                            // other slots wait for the response buffer
+  }
+
+  _accept();                                                // pick up new client (if a slot is free)
+
+  for ( int n = 0; n < _connCount; n++) {                   // visit all slots (round-robin)
+    int i = ( _next + n) % _connCount;
+
+    if ( _advance( _conns + i)) {                           // if slot has a request available
+      _next = ( i + 1) % _connCount;                        // next call starts after this slot
+      return true;                                          // _conn = slot with request
+    }
+
+    if ( _sending) return false;                            // error response not sent yet = wait for it
+  }
+
+  return false;                                             // no (complete) HTTP request yet
+}
+
+// close client connection
+void SimpleWebServerCore::disconnect()
+{
+  _clientStop();                                            // stop client session
+  _conn->state = CLIENT_ACCEPTING;                          // slot ready for next client
+}
+
+// assign new client session to a free connection slot (true = client accepted)
+bool SimpleWebServerCore::_accept()
+{
+  connection* slot = NULL;                                  // free slot
+  connection* idle = NULL;                                  // idle persistent slot (may be taken over)
+
+  for ( int i = 0; i < _connCount; i++) {
+    connection* conn = _conns + i;
+
+    if ( conn->state == CLIENT_ACCEPTING) { slot = conn; break; }
+    if ( conn->state != CLIENT_READING  ) continue;         // session busy with a request
+    if ( !conn->requests || conn->count ) continue;         // session not idle between requests
+    if ( conn->client.available()       ) continue;         // next request already sent = never drop it
+    if ( millis() - conn->timer < HTTP_KEEPALIVE_IDLE) continue;
+
+    if ( !idle || ( millis() - conn->timer > millis() - idle->timer)) idle = conn;
+  }                                                         // idle = longest idle persistent slot
+
+  if ( !slot && !idle) return false;                        // pool exhausted = leave client queued
+
+  client_t client = _server.available();
+
+  if ( !client) return false;                               // no client = nothing to do
+
+  for ( int i = 0; i < _connCount; i++) {                   // ignore clients already owning a slot
+    if (( _conns[ i].state != CLIENT_ACCEPTING) && ( _conns[ i].client == client)) return false;
+  }
+
+  if ( !slot) {                                             // no free slot = close idle session
+    _conn = slot = idle;
+    disconnect();
+  }
+
+  slot->client    = client;                                 // start new session in slot
+  slot->timer     = millis();                               // start request timer
+  slot->state     = CLIENT_READING;
+  slot->requests  = 0;
+  slot->keepAlive = false;
+  slot->count     = 0;                                      // reset buffer
+  slot->parsed    = 0;                                      // reset parser
+  slot->mode      = SERVER_METH_INIT;
+  slot->buffer[0] = 0;
+  _clientReset( slot);                                      // no response of previous session
+
+  return true;
+}
+
+// progress connection slot without blocking (true = HTTP request available)
+bool SimpleWebServerCore::_advance( connection* conn)
+{
+  _conn = conn;                                             // slot becomes active connection
+
+  switch ( _conn->state) {
+  case CLIENT_READING : {                                   // collect request data
+    int size = _conn->client.available();                   // size of new data
+
+    if ( size > _bufferSize - 1 - _conn->count) size = _bufferSize - 1 - _conn->count;
+
+    if ( size > 0) {                                        // if new client data available (and fits)
+      if ( !_conn->count) _conn->timer = millis();          // restart timer on first byte of request
+
+      size = _conn->client.read( (uint8_t*) _conn->buffer + _conn->count, size);
+      if ( size > 0) {                                      // read block of client data
+        _conn->count += size;
+        _metricsBytes( size, true);
+      }
+      _conn->buffer[ _conn->count] = 0;                     // keep buffer terminated
+
+#ifdef SIMPLE_WEBSERVER_DEBUG
+      PRINT( "#####") LF;
+      PRINT( _conn->buffer + _conn->parsed);                // print new part of HTTP request
+      PRINT( "#####") LF;
+#endif
+    }
+
+    uint8_t result = _parseRequest();                       // parse new data
+
+    if ( result == PARSE_NEED_MORE) break;                  // wait for more data
+
+    if ( result == PARSE_ERROR) {                           // if invalid HTTP request
+      _conn->keepAlive = false;                             // invalid request = close after error
+      _respondEmpty( _conn->error);                         // invalid request = send error
+      _metricsError( _conn->error);
+      _clientNext();                                        // send error, then close session
+      break;
+    }
+
+    if ( _conn->body == BODY_NONE) {                        // if valid HTTP request without body
+      _conn->state = CLIENT_PARSED;
+      return true;                                          // success: HTTP request available
+    }
+
+    if ( _conn->expect) {                                   // client waits for permission to send body
+      CPRINT( F( "HTTP/1.1 100 Continue\r\n\r\n"));
+      _flush();
+    }
+
+    _conn->bodyFunc = _bodyRoute();                         // body goes to matched route (none = dropped)
+    _conn->timer = millis();                                // restart timer for body
+    _conn->state = CLIENT_BODY;                             // no break = process body data
+  }
+
+  case CLIENT_BODY : {                                      // stream request body to body callback
+    if ( _conn->used < _conn->count) {                      // body data already in buffer
+      _conn->used += _parseBody( _conn->buffer + _conn->used, _conn->count - _conn->used);
+    }
+
+    while (( _conn->body != BODY_NONE) && ( _conn->body != BODY_ERROR) && _conn->client.available()) {
+      size_t size = _conn->client.available();              // size of new data
+      size_t want = ( _conn->body == BODY_DATA) ? _conn->bodyLeft : _bufferSize - 1 - _conn->count;
+                                                            // chunked = data beyond body end must fit buffer
+      if ( !want                ) want = 1;                 // no room for pipelined data = read byte by byte
+      if ( size > want          ) size = want;              // never read beyond body
+      if ( size > CHUNK_BLOCK    ) size = CHUNK_BLOCK;
+#if HTTP_CHUNK_SIZE
+      char* block = _chunk;                                 // body block (shared staging area)
+#else
+      char  block[ CHUNK_BLOCK];                            // body block (on stack, no staging area)
+#endif
+      int read = _conn->client.read( (uint8_t*) block, size);
+
+      if ( read <= 0) break;
+      _metricsBytes( read, true);
+
+      size_t done = _parseBody( block, read);               // deliver block of body data (incl. chunk lines)
+
+      if ( done < (size_t) read) {                          // pipelined request after end of body
+        memcpy( _conn->buffer + _conn->count, block + done, read - done);
+        _conn->count += read - done;
+        _conn->buffer[ _conn->count] = 0;                   // keep buffer terminated
+      }
+      _conn->timer = millis();                              // restart timer on body data
+    }
+
+    if ( _conn->body == BODY_ERROR) {                       // if invalid chunk encoding
+      _conn->keepAlive = false;                             // invalid request = close after error
+      _respondEmpty( 400);                                  // invalid request = send error
+      _metricsError( 400);
+      _clientNext();                                        // send error, then close session
+      break;
+    }
+
+    if ( _conn->body == BODY_NONE) {                        // if body complete
+      _conn->state = CLIENT_PARSED;
+      return true;                                          // success: HTTP request available
+    }
+    break;
+  }
+
+  case CLIENT_PARSED :                                      // request still pending (not handled yet)
+    return true;
+
+  case CLIENT_SENDING :                                     // rest of response in slot buffer or response buffer
+    if ( _conn->tail) {
+      char*  tail = _conn->buffer + _conn->count + 1;       // rest of response (behind pipelined data)
+      size_t sent = _send( tail, _conn->tail, false);
+
+      _conn->tail -= sent;
+      memmove( tail, tail + sent, _conn->tail);             // keep unsent rest
+      if ( _conn->tail) break;                              // client send buffer still full
+    } else {
+      if ( !_flush( false)) break;                          // client send buffer still full
+
+      _sending = NULL;                                      // response buffer free for other slots
+    }
+
+    _clientDone();                                          // keep or close session
+    return false;
+  }
+
+  if ( _conn->state == CLIENT_SENDING) {
+    if ( !_conn->client.connected() || ( millis() - _conn->timer > HTTP_WRITE_TIMEOUT)) {
+      _conn->tail = 0;                                      // client gone or too slow = drop response
+      if ( _sending == _conn) { _outputCount = 0; _sending = NULL; }
+      _conn->state = CLIENT_CLOSING;
+    }
+  }
+
+  if (( _conn->state == CLIENT_READING) || ( _conn->state == CLIENT_BODY)) {
+    unsigned long timeout = ( _conn->requests && !_conn->count) ? HTTP_KEEPALIVE_TIMEOUT : HTTP_READ_TIMEOUT;
+
+    if ( !_conn->client.connected()) {
+      _conn->state = CLIENT_CLOSING;                        // client gone = give up
+    } else
+    if ( millis() - _conn->timer > timeout) {
+      _conn->state = CLIENT_CLOSING;                        // client idle or too slow = give up
+    }
+  }
+
+  if ( _conn->state == CLIENT_CLOSING) disconnect();        // release slot of ended session
+
+  return false;
+}
+
+// deliver (part of) request body to body callback (returns number of bytes handled)
+size_t SimpleWebServerCore::_parseBody( const char* data, size_t size)
+{
+  size_t i = 0;                                             // first unhandled byte
+
+  while (( i < size) && ( _conn->body != BODY_NONE) && ( _conn->body != BODY_ERROR)) {
+    char c = data[ i];
+
+    switch ( _conn->body) {
+    case BODY_DATA  :                                       // body data (Content-Length)
+    case BODY_CHUNK : {                                     // chunk data (Transfer-Encoding: chunked)
+      size_t part = ( size - i < _conn->bodyLeft) ? size - i : _conn->bodyLeft;
+
+      if ( part > CHUNK_BLOCK) part = CHUNK_BLOCK;          // deliver in blocks of max HTTP_CHUNK_SIZE
+
+      if ( _conn->bodyFunc) (*_conn->bodyFunc)( data + i, part);
+                                                            // deliver data to body callback (of matched route)
+
+      i += part;
+      _conn->bodyLeft -= part;
+      if ( !_conn->bodyLeft) _conn->body = ( _conn->body == BODY_DATA) ? BODY_NONE : BODY_NEXT;
+      continue;                                             // continue = data already skipped
+    }
+
+    case BODY_SIZE  :                                       // chunk size line (hex)
+      if ( isxdigit( c)) {
+        if ( _conn->bodyLeft >> 27) { _conn->body = BODY_ERROR; break; }
+        _conn->bodyLeft = ( _conn->bodyLeft << 4) | ( isdigit( c) ? c - '0' : ( c | 0x20) - 'a' + 10);
+        break;
+      }
+      if (( c == ';') || ( c == ' ')) { _conn->body = BODY_EXTN; break; }
+      if (  c == '\r') break;                               // no break = end of chunk size line
+      if (  c != '\n') { _conn->body = BODY_ERROR; break; }
+
+    case BODY_EXTN  :                                       // chunk extension (ignored)
+      if (  c != '\n') break;
+      _conn->body = _conn->bodyLeft ? BODY_CHUNK : BODY_TRAIL;
+      break;                                                // size = 0 = last chunk
+
+    case BODY_NEXT  :                                       // end of chunk data (CR/LF)
+      if (  c != '\n') break;
+      _conn->body     = BODY_SIZE;                          // next chunk size line
+      _conn->bodyLeft = 0;
+      break;
+
+    case BODY_TRAIL :                                       // trailer lines (ignored)
+      if (  c == '\r') break;
+      if (  c != '\n') { _conn->bodyLeft = 1; break; }      // line has content
+      if ( !_conn->bodyLeft) _conn->body = BODY_NONE;       // empty line = end of body
+      _conn->bodyLeft = 0;
+      break;
+    }
+
+    i++;                                                    // next byte
+  }
+
+  return i;                                                 // number of bytes handled
+}
+
+// set default callback function receiving request body (data, size), used by routes without own body callback
+void SimpleWebServerCore::onBody( BodyFunc func)
+{
+  _bodyFunc = func;                                         // store body callback
+}
+
+// find body callback of the route handling the request (same order as handleRequest), NULL = no route
+BodyFunc SimpleWebServerCore::_bodyRoute()
+{
+  uint16_t hash = path( 0) ? HTTP_Hash( path( 0)) : 0;      // hash of requested device
+
+  for ( size_t i = 0; i < _routeCount; i++) {               // for all route table entries
+    const SimpleWebRoute* route = _routes + i;
+
+    if ( pgm_read_word( &route->hash) != hash) continue;    // skip on hash mismatch (no flash string read)
+    if ( strcmp_P( path( 0), route->device)) continue;      // skip on hash collision
+    if ( method(( HTTPMethod) pgm_read_byte( &route->method))) return _bodyFunc;
+  }
+
+  if ( _routeRoot.child) {                                  // if route trie available
+    routeNode* node = _routeMatch( &_routeRoot, _conn->paramCount = 0);
+
+    for ( routeFunc* item = node ? node->funcs : NULL; item; item = item->next) {
+      if ( method( item->method)) return item->body ? item->body : _bodyFunc;
+    }
+  }
+
+  for ( SimpleWebServerTask* task = (SimpleWebServerTask*) _rootTask; task; task = (SimpleWebServerTask*) task->next()) {
+    if (( task->hash() == hash) && path( 0, task->device()) && method( task->method())) {
+      return task->body() ? task->body() : _bodyFunc;
+    }
+  }
+
+  return NULL;                                              // no route = 404 / 405 (body is read and dropped)
+}
+
+// attach callback function (callback, device or route pattern, method, body callback or NULL = onBody callback)
+bool  SimpleWebServerCore::handleOn( TaskFunc func, const char* name, HTTPMethod method, BodyFunc body)
+{
+  if ( name && ( name[ 0] == '/')) {                        // route pattern (e.g. "/relays/{id:int}")
+    return _routeAdd( func, NULL, name, method, body);      // add to route trie
+  }
+
+  void* memory = _routeArena.alloc( sizeof( SimpleWebServerTask));
+
+  if ( !memory) return false;                               // route arena full = route not added
+
+  SimpleWebServerTask* task = new ( memory) SimpleWebServerTask( func, name, method, _routeArena, body);
+                                                            // create new webserver task (in route arena)
+  if ( name && !task->device()) return false;               // no room for device copy = route not added
+
+  _attach( task);                                           // attach task to list
+
+  return true;
+}
+
+// set callback function with request context for device and method (callback, device or route pattern, method, body callback)
+bool  SimpleWebServerCore::handleOn( ContextFunc func, const char* name, HTTPMethod method, BodyFunc body)
+{
+  if ( name && ( name[ 0] == '/')) {                        // route pattern (e.g. "/relays/{id:int}")
+    return _routeAdd( NULL, func, name, method, body);      // add to route trie
+  }
+
+  void* memory = _routeArena.alloc( sizeof( SimpleWebServerTask));
+
+  if ( !memory) return false;                               // route arena full = route not added
+
+  SimpleWebServerTask* task = new ( memory) SimpleWebServerTask( func, name, method, _routeArena, body);
+                                                            // create new webserver task (in route arena)
+  if ( name && !task->device()) return false;               // no room for device copy = route not added
+
+  _attach( task);                                           // attach task to list
+
+  return true;
+}
+
+// attach route table in PROGMEM (table, number of entries)
+void SimpleWebServerCore::handleOn( const SimpleWebRoute* routes, size_t count)
+{
+  _routes     = routes;                                     // store route table
+  _routeCount = count;
+}
+
+// attach static asset table in PROGMEM (table, number of entries)
+void SimpleWebServerCore::serveStatic( const SimpleWebAsset* assets, size_t count)
+{
+  _assets     = assets;                                     // store asset table
+  _assetCount = count;
+
+  if ( count > _assetRoom) {                                // tags of previous table too small = new array
+    uint32_t* tags = (uint32_t*) _routeArena.alloc( count * sizeof( uint32_t));
+
+    if ( tags) { _assetTags = tags; _assetRoom = count; }   // arena full = hashed per request
+  }
+                                                            // hash content once (array reused by next call)
+  for ( size_t i = 0; ( count <= _assetRoom) && ( i < count); i++) {
+    SimpleWebAsset asset;                                   // copy of asset entry (from FLASH)
+
+    memcpy_P( &asset, assets + i, sizeof( asset));
+    _assetTags[ i] = _assetTag( asset);
+  }
+}
+
+// cache GET responses (memory budget in bytes, 0 = no cache)
+void SimpleWebServerCore::cache( size_t budget)
+{
+  _cacheBudget = budget;                                    // store memory budget
+  invalidate();                                             // start with empty cache
+}
+
+// drop cached responses for device (e.g. "relays" after a PUT on "/relays/3"), NULL = all
+void SimpleWebServerCore::invalidate( const char* device)
+{
+  size_t       size = device ? strlen( device) : 0;
+  cacheEntry** link = &_cacheList;
+
+  while ( *link) {
+    cacheEntry* entry = *link;
+    bool        match = !device;
+
+    if ( !match && ( entry->keySize > size) && !strncmp( entry->data + 1, device, size)) {
+      char next = entry->data[ size + 1];                   // key = "/device", "/device/..." or "/device?..."
+
+      match = ( size + 1 == entry->keySize) || ( next == '/') || ( next == '?');
+    }
+
+    if ( match) {
+      *link = entry->next;                                  // unlink entry
+      _cacheFree( entry);
+    } else {
+      link = &entry->next;
+    }
+  }
+}
+
+// return route arena (tasks, route trie), e.g. to check peak() against HTTP_ROUTE_ARENA
+SimpleArena& SimpleWebServerCore::routeArena()
+{
+  return _routeArena;
+}
+
+// return per-request scratch arena (reset for each request)
+SimpleArena& SimpleWebServerCore::scratchArena()
+{
+  return _scratchArena;
+}
+
+// serve metrics on path (Prometheus text format, NULL = off)
+void SimpleWebServerCore::metrics( const char* path)
+{
+#if HTTP_METRICS_ROUTES
+  _metricsPath = path;
+#else
+  (void) path;                                              // metrics not compiled in (HTTP_METRICS_ROUTES = 0)
+#endif
+}
+
+// route to first matching callback only (true), or to all matching callbacks (false)
+void SimpleWebServerCore::firstMatch( bool first)
+{
+  _firstMatch = first;                                      // store dispatch mode
+}
+
+// route incoming requests to the proper callback function
+void SimpleWebServerCore::handleRequest()
+{
+  uint16_t hash  = path( 0) ? HTTP_Hash( path( 0)) : 0;     // hash of requested device
+  uint8_t  allow = 0;                                       // methods available on requested path
+
+  for ( size_t i = 0; i < _routeCount; i++) {               // for all route table entries
+    const SimpleWebRoute* route = _routes + i;
+    HTTPMethod            meth  = (HTTPMethod) pgm_read_byte( &route->method);
+
+    if ( pgm_read_word( &route->hash) != hash) continue;    // skip on hash mismatch (no flash string read)
+    if ( strcmp_P( path( 0), route->device)) continue;      // skip on hash collision
+    if ( !method( meth)) { allow |= METHOD_BIT( meth); continue; }
+
+    _metricsRoute( route->device, true);                    // first executed route = metrics label
+    _execute(( TaskFunc) pgm_read_ptr( &route->func), ( ContextFunc) pgm_read_ptr( &route->context));
+    if ( _firstMatch) return;
+  }
+
+  if ( _routeRoot.child) {                                  // if route trie available
+    routeNode* node = _routeMatch( &_routeRoot, _conn->paramCount = 0);
+
+    for ( routeFunc* item = node ? node->funcs : NULL; item; item = item->next) {
+      if ( !method( item->method)) { allow |= METHOD_BIT( item->method); continue; }
+
+      _metricsRoute( item->pattern, false);
+      _execute( item->func, item->context);                 // execute callback function
+      if ( _firstMatch) return;
+    }
+  }
+
+  SimpleWebServerTask* task = (SimpleWebServerTask*) _rootTask;
+                                                            // first task entry in task list
+  while ( task != NULL) {                                   // whlle task entry is valid
+    if (( task->hash() == hash) && path( 0, task->device())) {
+      if ( method( task->method())) {
+        _metricsRoute( task->device(), false);
+        _execute( task->func(), task->context());           // execute callback function
+        if ( _firstMatch) return;
+      } else {
+        allow |= METHOD_BIT( task->method());
+      }
+    }
+
+    task = (SimpleWebServerTask*) task->next();             // next task entry
+  }
+
+  if ( !_firstMatch) return;                                // all mode = callbacks decide on response
+
+  _conn->allow = allow;                                     // methods for Allow header
+  _respondEmpty( allow ? 405 : 404);                        // path known = 405, else 404
+}
+
+// execute callback, TaskFunc callbacks exchange the response code via returnCode
+void SimpleWebServerCore::_execute( TaskFunc func, ContextFunc context)
+{
+  if ( context) {
+    connection*    conn = _conn;                            // active connection
+    RequestContext request( *this, conn - _conns);          // request of active connection
+
+    (*context)( request);                                   // execute callback function
+    _conn = conn;                                           // callback may have changed active connection
+  } else if ( func) {
+    returnCode = _conn->status;                             // legacy callback = response code via global
+
+    (*func)();                                              // execute callback function
+    if ( !_conn->header && !_conn->pending) _conn->status = returnCode;
+                                                            // response code for response after callback
+  }
+}
+
+// add route pattern to route trie (callback, pattern, method, body callback)
+bool SimpleWebServerCore::_routeAdd( TaskFunc func, ContextFunc context, const char* pattern, HTTPMethod method, BodyFunc body)
+{
+  routeNode*  node = &_routeRoot;                           // start at trie root
+  const char* item = pattern + 1;                           // first path item (skip '/')
+
+  while ( node) {                                           // for all path items in pattern
+    const char* stop  = strchr( item, '/');                 // end of path item
+    size_t      size  = stop ? stop - item : strlen( item); // length of path item
+    uint8_t     type  = ROUTE_TEXT;                         // literal path item
+
+    if (( size >= 2) && ( item[ 0] == '{') && ( item[ size - 1] == '}')) {
+      const char* colon = (const char*) memchr( item, ':', size);
+                                                            // parameter (e.g. {id} or {id:int})
+      type = ( colon && !strncmp( colon + 1, "int}", 4)) ? ROUTE_INT : ROUTE_STR;
+      size = ( colon ? colon : item + size - 1) - item - 1; // length of parameter label
+      item++;                                               // skip '{'
+    }
+
+    node = _routeNode( node, item, size, type);             // find or create node for path item
+
+    if ( !stop) break;                                      // last path item
+    item = stop + 1;                                        // next path item
+  }
+
+  if ( !node) return false;                                 // route arena full
+
+  routeFunc*  call = (routeFunc*) _routeArena.alloc( sizeof( routeFunc));
+  routeFunc** last = &node->funcs;                          // create route callback (in route arena)
+
+  if ( !call) return false;                                 // route arena full
+
+  call->method  = method;
+  call->func    = func;
+  call->context = context;
+  call->body    = body;
+  call->next    = NULL;
+#if HTTP_METRICS_ROUTES
+  call->pattern = _routeArena.copy( pattern);               // metrics label (NULL = arena full)
+#else
+  call->pattern = NULL;
+#endif
+
+  while ( *last) last = &(*last)->next;                     // keep registration order
+  *last = call;
+
+  return true;
+}
+
+// find or create child node (parent, label, size of label, type)
+SimpleWebServerCore::routeNode* SimpleWebServerCore::_routeNode( routeNode* parent, const char* label, size_t size, uint8_t type)
+{
+  routeNode** last = &parent->child;                        // insert position (sorted by type)
+
+  for ( routeNode* node = parent->child; node; node = node->next) {
+    if (( node->type == type) && !strncmp( node->label, label, size) && !node->label[ size]) return node;
+    if (  node->type <= type) last = &node->next;           // text before int before string
+  }
+
+  routeNode* node = (routeNode*) _routeArena.alloc( sizeof( routeNode));
+                                                            // create new node (in route arena)
+  if ( !node) return NULL;                                  // route arena full
+
+  node->label = _routeArena.copy( label, size);             // copy label
+
+  if ( !node->label) return NULL;                           // route arena full
+  node->type  = type;
+  node->child = NULL;
+  node->funcs = NULL;
+  node->next  = *last;                                      // insert node in sibling list
+  *last       = node;
+
+  return node;
+}
+
+// match path items with route trie (node, depth), NULL = no match
+SimpleWebServerCore::routeNode* SimpleWebServerCore::_routeMatch( routeNode* node, int depth)
+{
+  if ( depth == _conn->pathCount) return node->funcs ? node : NULL;
+
+  const char* item = _conn->path[ depth];                   // path item at this depth
+
+  for ( routeNode* child = node->child; child; child = child->next) {
+    int count = _conn->paramCount;                          // number of parameters before this node
+
+    if ( child->type == ROUTE_TEXT) {                       // literal path item
+      if ( strcmp( child->label, item)) continue;
+    } else {                                                // parameter
+      char* stop   = NULL;
+      long  number = strtol( item, &stop, 10);              // value of integer parameter
+
+      if ( !*item) continue;                                // parameter may not be empty
+      if (( child->type == ROUTE_INT) && *stop) continue;   // integer parameter must be a number
+
+      _conn->params[ count].label  = child->label;          // capture parameter
+      _conn->params[ count].value  = item;
+      _conn->params[ count].number = number;
+      _conn->paramCount++;
+    }
+
+    routeNode* found = _routeMatch( child, depth + 1);      // match next path items
+
+    if ( found) return found;
+    _conn->paramCount = count;                              // no match = drop captured parameter
+  }
+
+  return NULL;                                              // no matching route
+}
+
+// true = Accept-Encoding value allows gzip (e.g. "gzip, deflate" or "*;q=0, gzip" but not "gzip;q=0")
+static bool acceptGzip( const char* value)
+{
+  int8_t gzip = -1;                                         // gzip listed (1 = acceptable, 0 = q=0, -1 = not listed)
+  int8_t star = -1;                                         // "*"  listed (1 = acceptable, 0 = q=0, -1 = not listed)
+
+  while ( value && *value) {
+    while (( *value == ' ') || ( *value == ',')) value++;   // skip separators
+
+    const char* item = value;                               // coding (e.g. "gzip", "*")
+    const char* stop = value + strcspn( value, ",");        // end of list item
+    size_t      size = strcspn( item, " ;,");               // size of coding
+    bool        okay = true;                                // no quality value = acceptable
+
+    for ( const char* q = item + size; q < stop; q++) {    // find ";q=" of this item only
+      if (( *q != ';') && ( *q != ' ')) continue;
+      while (( q < stop) && (( *q == ';') || ( *q == ' '))) q++;
+      if (( q + 2 > stop) || (( *q | 0x20) != 'q') || ( q[ 1] != '=')) continue;
+
+      for ( q += 2; ( q < stop) && (( *q == '0') || ( *q == '.')); q++);
+      okay = ( q < stop) && ( *q >= '1') && ( *q <= '9');   // q=0 (or 0.000) = not acceptable
+      break;
+    }
+
+    if (( size == 4) && !strncasecmp( item, "gzip", 4)) gzip = okay;
+    if (( size == 1) && ( *item == '*')               ) star = okay;
+
+    value = *stop ? stop + 1 : NULL;                        // next list item
+  }
+
+  return ( gzip >= 0) ? gzip : ( star > 0);                 // gzip itself decides, else "*"
+}
+
+// content hash of asset (FNV-1a of content and gzip variant, PROGMEM), used as entity tag
+uint32_t SimpleWebServerCore::_assetTag( const SimpleWebAsset& asset)
+{
+  uint32_t hash = 2166136261UL;                             // FNV-1a offset basis
+
+  for ( size_t n = 0; n < asset.size    ; n++) hash = ( hash ^ pgm_read_byte( asset.data + n)) * 16777619UL;
+  for ( size_t n = 0; n < asset.gzipSize; n++) hash = ( hash ^ pgm_read_byte( asset.gzip + n)) * 16777619UL;
+
+  return hash;
+}
+
+// send static asset matching request path (304 if client has current version), false = no asset
+bool SimpleWebServerCore::_serveAsset()
+{
+  if ( !_assetCount || ( _conn->method != HTTP_GET)) return false;
+
+  uint16_t hash = 5381;                                     // hash of full path (same as HTTP_Hash)
+
+  for ( int i = 0; i < _conn->pathCount; i++) {             // hash of "/" + path item (for all path items)
+    hash = ( hash * 33) ^ '/';
+    for ( const char* c = _conn->path[ i]; *c; c++) hash = ( hash * 33) ^ ( *c | 0x20);
+  }
+
+  for ( size_t i = 0; i < _assetCount; i++) {               // for all asset table entries
+    if ( pgm_read_word( &_assets[ i].hash) != hash) continue;
+                                                            // quick reject on hash
+    SimpleWebAsset asset;                                   // copy of asset entry (from FLASH)
+    const char*    match = asset.path;
+
+    memcpy_P( &asset, _assets + i, sizeof( asset));
+
+    for ( int n = 0; match && ( n < _conn->pathCount); n++) {
+      size_t size = strlen( _conn->path[ n]);               // compare full path with path items
+
+      match = (( *match == '/') && !strncmp( match + 1, _conn->path[ n], size)) ? match + size + 1 : NULL;
+    }
+
+    if ( !match || *match) continue;                        // path differs
+
+    _metricsRoute( _assets[ i].path, true);                 // asset path = metrics label
+
+    bool gzip = asset.gzip && acceptGzip( header( "Accept-Encoding"));
+                                                            // true = send gzip variant
+    _conn->vary = asset.gzip != NULL;                       // gzip variant = content depends on Accept-Encoding
+
+    if ( !gzip && !asset.data) {                            // gzip variant only, but not accepted
+      _respondEmpty( 406);
+      return true;
+    }
+
+    char     etag[ 11];                                     // entity tag (e.g. "1a2b3c4d")
+    uint32_t code = ( _assetCount <= _assetRoom) ? _assetTags[ i] : _assetTag( asset);
+                                                            // content hash (changes with content only)
+    if ( gzip) {
+      asset.data  = asset.gzip;                             // send gzip variant
+      asset.size  = asset.gzipSize;
+      _conn->gzip = true;                                   // true = content is gzip encoded
+      code       ^= 0x80000000UL;                           // entity tag differs per variant
+    }
+
+    etag[ 0] = etag[ 9] = '"'; etag[ 10] = 0;
+
+    for ( int n = 8; n > 0; n--, code >>= 4) {
+      etag[ n] = "0123456789abcdef"[ code & 0x0F];          // entity tag (hex)
+    }
+
+    const char* known = header( "If-None-Match");           // entity tag(s) cached by client
+
+    _conn->etag = etag;
+
+    if ( known && ( strstr( known, etag) || !strcmp( known, "*"))) {
+      respond( 304, asset.type, (size_t) 0);                // client version is current (no content)
+    } else {
+      respond( 200, asset.type, asset.size);                // send OK + content size
+      _sendContent_P( asset.data, asset.size);              // send content (from FLASH)
+    }
+
+    _conn->etag = NULL;                                     // entity tag only valid in this scope
+    return true;
+  }
+
+  return false;
+}
+
+// main E2E loop (from connect to disconnect), returns immediately if no progress can be made
+void SimpleWebServerCore::handle()
+{
+  for ( int n = 0; n < _connCount; n++) {                   // serve each ready slot once per call
+    if ( !connect()) break;                                 // if no new request available from client
+
+    _conn->state = CLIENT_RESPONDING;
+    _conn->status = 400;                                    // default response code = error
+    _scratchArena.reset();                                  // release scratch memory of previous request
+    _metricsBegin();                                        // start latency measurement
+
+    if ( _metricsServe()) {                                 // built-in metrics route (e.g. "/metrics")
+    } else if ( _serveAsset()) {                            // static asset (e.g. "/index.html")
+    } else if (( _conn->pathCount == 1) && ( _conn->argsCount == 0) && ( path( 0, ""))) {
+      _metricsRoute( PSTR( "/"), true);
+      respond( 200, "text/plain", strlen( name()) + 2);     // HTTP identify
+      sendLine( name());                                    // response to client
+    } else if ( _cacheSend()) {                             // cached response = callback not needed
+      _metricsRoute( PSTR( "(cache)"), true);
+    } else {
+      handleRequest();                                      // handle request
+    }
+
+    _respondEmpty( _conn->status);                          // send response (if not sent by callback)
+    _clientNext();                                          // keep or close client session
+    _metricsEnd();                                          // add request to metrics (incl. sending)
+
+    yield();                                                // provide time fpr system tasks
+  }
+}
+
+// send response (code = 200 OK), header waits for content (sent by callback = content ends at session close,
+// none = empty response after callback)
+void SimpleWebServerCore::respond( int code)
+{
+  if ( _conn->header || _conn->pending) return;             // response already started
+
+  _conn->status  = code;                                    // response code (sent with content or after callback)
+  _conn->pending = true;                                    // true = header waits for content
+}
+
+// send header of respond( code) when content follows (content size not known = ends at session close)
+void SimpleWebServerCore::_sendPending()
+{
+  if ( !_conn->pending) return;                             // no header waiting
+
+  _conn->pending = false;
+  _sendHeader( _conn->status);                              // send header with response code
+  _conn->header  = true;                                    // true = header was sent
+}
+
+// send response without content (code), e.g. after a callback without content (Content-Length: 0 = session kept)
+void SimpleWebServerCore::_respondEmpty( int code)
+{
+  _conn->pending = false;                                   // no content = header of respond( code) not needed
+  _sendHeader( code, NULL, 0);                              // send header with response code (no content)
+  _conn->header  = true;                                    // true = header was sent
+}
+
+// send response (code, content type, content size)
+void SimpleWebServerCore::respond( int code, const char* content_type, size_t size)
+{
+  _sendHeader( code, content_type, size);                   // send header with response code + content type
+
+  _conn->header = true;                                     // true = header was sent
+}
+
+// send response (code, content type, content)
+void SimpleWebServerCore::respond( int code, const char* content_type, const char* content)
+{
+  if ( content) {                                           // if valid content
+    _sendHeader ( code, content_type, strlen( content));    // send header (code, content type, content size)
+    _sendContent( content);                                 // send content
+
+    _conn->header  = true;                                  // true = header  was sent
+    _conn->content = true;                                  // true = content was sent
+    _conn->newline = true;                                  // true = extra CR/NL required
+  } else {
+    _sendHeader( code, content_type);                       // send header (code, content type)
+
+    _conn->header  = true;                                  // true = header  was sent
+  }
+}
+
+// send response (code, content label, content value)
+void SimpleWebServerCore::sendContent( const char* content)
+{
+  if ( content) {
+    _sendContent( content);                                 // send content
+
+    _conn->content = true;                                  // true = content was sent
+    _conn->newline = true;                                  // true = extra CR/NL required
+  }
+}
+
+// send response (code, content label, content value)
+void SimpleWebServerCore::sendLine( const char* label, const char* value)
+{
+  if ( label) _sendContent( label);                         // if valid label send label
+  if ( value) _sendContent( value);                         // if valid label send value
+
+  _sendContent( "\r\n");                                    // send end of line message
+
+  _conn->content = true;                                    // true = content was sent
+  _conn->newline = false;                                   // true = extra CR/NL required
+}
+
+// send response (code, content label, content value)
+void SimpleWebServerCore::sendLine( const __FlashStringHelper* label, const char* value)
+{
+  if ( label) _sendContent( label);                         // if valid label send label
+  if ( value) _sendContent( value);                         // if valid label send value
+
+  _sendContent( "\r\n");                                    // send end of line message
+
+  _conn->content = true;                                    // true = content was sent
+  _conn->newline = false;                                   // true = extra CR/NL required
+}
+
+// start chunked response (code, content type), content follows via writeChunk() / sendContent() / sendLine()
+void SimpleWebServerCore::beginChunked( int code, const char* content_type)
+{
+  _sendPending();                                           // header of respond( code) = content ends at close
+  if ( _conn->header) return;                               // header already sent
+
+  if ( strCmp( _conn->version, "1.1")) {                    // chunked encoding requires HTTP/1.1
+    _sendHeader( code, content_type, HTTP_SIZE_CHUNKED);    // send header (Transfer-Encoding: chunked)
+    _conn->chunked = true;                                  // true = chunked response in progress
+  } else {
+    _sendHeader( code, content_type);                       // send header (content ends at session close)
+  }
+
+  _conn->header = true;                                     // true = header was sent
+}
+
+// send response chunk (data, size)
+void SimpleWebServerCore::writeChunk( const char* data, size_t size)
+{
+  if ( !_conn->client.connected() || !size) return;         // empty chunk would end the response
+
+  if ( !_conn->header) beginChunked();                      // no header yet = start chunked response (200 OK)
+
+  if ( _conn->chunked) {
+    _flushChunk();                                          // send staged content first
+
+    char  line[ 2 * sizeof( size_t) + 3];                   // chunk size line (hex + CR/NL)
+    char* next = line + sizeof( line);
+
+    *--next = '\n';
+    *--next = '\r';
+
+    for ( size_t n = size; n || ( next == line + sizeof( line) - 2); n >>= 4) {
+      *--next = "0123456789abcdef"[ n & 0x0F];              // chunk size (hex)
+    }
+
+    _write( next, line + sizeof( line) - next);             // send chunk size line
+    _write( data, size);                                    // send chunk data
+    _write( "\r\n", 2);                                     // send end of chunk
+  } else {
+    _write( data, size);                                    // send content (no chunked encoding)
+  }
+
+  _conn->sent   += size;                                    // track content size
+  _conn->content = true;                                    // true = content was sent
+}
+
+// send response chunk (content)
+void SimpleWebServerCore::writeChunk( const char* content)
+{
+  if ( content) writeChunk( content, strlen( content));
+}
+
+// send response chunk (FLASH content)
+void SimpleWebServerCore::writeChunk( const __FlashStringHelper* content)
+{
+  if ( !content) return;
+
+  if ( !_conn->header) beginChunked();                      // no header yet = start chunked response (200 OK)
+
+  _sendContent_P( (PGM_P) content, strlen_P( (PGM_P) content));
+  _conn->content = true;                                    // true = content was sent
+}
+
+// end chunked response (send last chunk)
+void SimpleWebServerCore::endChunked()
+{
+  if ( !_conn->chunked) return;                             // no chunked response in progress
+
+  _flushChunk();                                            // send staged content
+  _write( "0\r\n\r\n", 5);                                  // send last chunk (no trailers)
+
+  _conn->chunked = false;
+  _conn->length  = _conn->sent;                             // response complete = session may be kept
+  _conn->newline = false;                                   // true = extra CR/NL required
+}
+
+// send response content (Print interface)
+size_t SimpleWebServerCore::write( uint8_t c)
+{
+  return write( &c, 1);
+}
+
+// send response content (Print interface), without header a chunked response is started
+size_t SimpleWebServerCore::write( const uint8_t* data, size_t size)
+{
+  if ( !_conn->client.connected()) return 0;                // check if client still active
+
+  if ( !_conn->header) beginChunked();                      // content size not known = chunked response
+
+  if ( _frameAt != HTTP_SIZE_UNKNOWN) {                     // chunk framed in response buffer (no staging)
+    _frameWrite( (const char*) data, size);
+    return size;
+  }
+
+#if HTTP_CHUNK_SIZE
+  if ( !_conn->chunked || ( !_chunkCount && ( size >= HTTP_CHUNK_SIZE))) {
+    writeChunk( (const char*) data, size);                  // send as is (or as single chunk)
+    return size;
+  }
+
+  for ( size_t i = 0; i < size; i++) {                      // stage small writes (e.g. print( char))
+    _chunk[ _chunkCount++] = data[ i];                      // to send them as one chunk
+
+    if ( _chunkCount == HTTP_CHUNK_SIZE) _flushChunk();
+  }
+#else
+  writeChunk( (const char*) data, size);                    // no staging area = one chunk per write
+#endif
+
+  return size;
+}
+
+// return full HTTP request
+char* SimpleWebServerCore::request()
+{
+  return _conn->buffer;                                     // return HTTP request
+}
+
+// return method of HTTP request
+HTTPMethod SimpleWebServerCore::method()
+{
+  return _conn->method;                                     // return HTTP method
+}
+
+// true = active method equals targeted method
+bool SimpleWebServerCore::method( HTTPMethod method)
+{
+  return (( method == HTTP_ANY) || ( method == _conn->method));
+}                                                           // verify valid method
+
+// return number of (recognized) path items
+int SimpleWebServerCore::pathCount()
+{
+  return _conn->pathCount;                                  // return number of items in path array
+}
+
+// returns value of HTTP path at index i
+const char* SimpleWebServerCore::path( uint8_t i)
+{
+  return ( i < _conn->pathCount) ? _conn->path[ i] : NULL;
+}                                                           // return path item at index i
+
+// checks if pathItem exists at index i
+bool SimpleWebServerCore::path( uint8_t i, const char* pathItem)
+{
+  return ( i < _conn->pathCount) ? strCmp( pathItem, _conn->path[ i]) : false;
+}                                                           // return true if pathItem exists
+
+// return number of (recognized) arguments
+int SimpleWebServerCore::argsCount()
+{
+  return _conn->argsCount;                                  // return number of items in args array
+}
+
+// return value of argument with a specfic label
+const char* SimpleWebServerCore::arg( const char* label)
+{
+  for ( int i = 0; i < _conn->argsCount; i++) {             // for all args items
+    if ( strCmp( _conn->args[ i].label, label)) {           // if label exists
+      return _conn->args[ i].value ? _conn->args[ i].value : _conn->args[ i].label;
+    }                                                      // return value at index i
+  }
+
+  return NULL;
+}
+
+// return true if value of argument with a specfic label exists
+bool SimpleWebServerCore::arg( const char* label, const char* value)
+{
+  bool found = false;                                       // true = combination found
+
+  for ( int i = 0; i < _conn->argsCount; i++) {             // for all args items
+    found |= (( strCmp( _conn->args[i].label, label)) &&
+              ( strCmp( _conn->args[i].value, value)));     // return true if value exists at index i
+  }
+
+  return found;                                             // return result
+}
+
+// return value of header with a specific label (only headers in HTTP_HEADER_LIST are available)
+const char* SimpleWebServerCore::header( const char* label)
+{
+#if MAX_HEADCOUNT
+  uint16_t hash = HTTP_Hash( label);                        // hash of label
+
+  for ( int i = 0; i < _conn->headCount; i++) {             // for all header items
+    if (( _conn->heads[ i].hash == hash) && !strcasecmp( _conn->heads[ i].label, label)) {
+      return _conn->heads[ i].value;                        // return value at index i
+    }
+  }
+#else
+  (void) label;                                             // no header index (MAX_HEADCOUNT = 0)
+#endif
+
+  return NULL;
+}
+
+// return value of path parameter with a specific label (e.g. "id" for "/relays/{id:int}")
+const char* SimpleWebServerCore::param( const char* label)
+{
+  for ( int i = 0; i < _conn->paramCount; i++) {            // for all path parameters
+    if ( strCmp( _conn->params[ i].label, label)) return _conn->params[ i].value;
+  }
+
+  return NULL;
+}
+
+// return value of integer path parameter with a specific label (0 = not found)
+long SimpleWebServerCore::paramInt( const char* label)
+{
+  for ( int i = 0; i < _conn->paramCount; i++) {            // for all path parameters
+    if ( strCmp( _conn->params[ i].label, label)) return _conn->params[ i].number;
+  }
+
+  return 0;
+}
+
+// break down HTTP request (e.g. "GET /path/1?arg1=0&arg2=1 HTTP/1.1"), resumes where the previous call stopped
+uint8_t SimpleWebServerCore::_parseRequest()
+{
+  char* buf  = _conn->buffer;                               // HTTP request buffer
+  int   mode = _conn->mode;                                 // state engine value
+  int   i    = _conn->parsed;                               // first unparsed char
+
+  for ( ; ( i < _conn->count) && ( mode != SERVER_HEAD_DONE) && ( mode != HTTP_REQUEST_ERR); i++) {
+    switch ( mode) {                                        // buffer loop (new data only)
+    case SERVER_METH_INIT :                                 // HTTP method read init
+      if (( buf[i] == '\r') || ( buf[i] == '\n')) {         // empty line before request line = ignored (RFC 7230 3.5)
+        memmove( buf + i, buf + i + 1, _conn->count - i);   // drop it (method is recognized at buffer start)
+        _conn->count--;
+        i--;                                                // same position = next char
+        break;
+      }
+
+      _conn->pathCount = 0;                                 // reset number of path items
+      _conn->argsCount = 0;                                 // reset number of argument items
+      _conn->headCount = 0;                                 // reset number of header items
+      _conn->paramCount = 0;                                // reset number of path parameters
+      _conn->body      = BODY_NONE;                         // no request body (yet)
+      _conn->bodyLeft  = 0;
+      _conn->bodyFunc  = NULL;                              // no body callback (set when body starts)
+      _conn->expect    = false;
+      _conn->allow     = 0;
+      _conn->error     = 400;                               // default error = bad request
+      mode = SERVER_METH_LOOP;                              // no break = include current char in read loop
+
+    case SERVER_METH_LOOP : {                               // HTTP method read loop
+      if ( buf[i] == '\r' || buf[i] == '\n') { mode = HTTP_REQUEST_ERR; break; }
+      if ( buf[i] != ' ') break;                            // break = next char
+
+      const char* name = NULL;                              // expected method name
+
+      switch (( i << 8) | buf[ 0]) {                        // recognize method by length + first char
+      case ( 3 << 8) | 'G' : _conn->method = HTTP_GET;     name = PSTR( "GET");     break;
+      case ( 3 << 8) | 'P' : _conn->method = HTTP_PUT;     name = PSTR( "PUT");     break;
+      case ( 4 << 8) | 'P' : _conn->method = HTTP_POST;    name = PSTR( "POST");    break;
+      case ( 5 << 8) | 'P' : _conn->method = HTTP_PATCH;   name = PSTR( "PATCH");   break;
+      case ( 6 << 8) | 'D' : _conn->method = HTTP_DELETE;  name = PSTR( "DELETE");  break;
+      case ( 7 << 8) | 'O' : _conn->method = HTTP_OPTIONS; name = PSTR( "OPTIONS"); break;
+      }
+
+      buf[i] = 0;                                           // terminate method
+      mode   = SERVER_METH_DONE;
+
+      if ( !name || strcmp_P( buf, name)) {                 // unsupported method = 501 (single compare)
+        _conn->error = 501;
+        mode         = HTTP_REQUEST_ERR;
+      }
+      break;                                                // break = next char
+    }
+
+    case SERVER_METH_DONE :                                 // HTTP method read done
+      if ( buf[i] == '/') { buf[i] = 0; mode = SERVER_PATH_INIT; break; }
+      mode = HTTP_REQUEST_ERR;
+      break;                                                // break = next char
+
+    case SERVER_PATH_INIT :                                 // HTTP path item read init
+      if ( _conn->pathCount == _maxPath) { mode = HTTP_REQUEST_ERR; break; }
+      _conn->path[ _conn->pathCount++] = buf + i;
+      mode = SERVER_PATH_LOOP;                              // no break = include current char in read loop
+
+    case SERVER_PATH_LOOP :                                 // HTTP path item read loop
+      if ( buf[i] == '/') { buf[i] = 0; mode = SERVER_PATH_INIT; break; }
+      if ( buf[i] == '?') { buf[i] = 0; mode = SERVER_ARGS_INIT; break; }
+      if ( buf[i] == ' ') { buf[i] = 0; mode = SERVER_HTTP_INIT; break; }
+      if ( buf[i] == '\r' || buf[i] == '\n') { mode = HTTP_REQUEST_ERR; break; }
+      break;                                                // break = next char
+
+    case SERVER_PATH_DONE :                                 // HTTP path item read done
+    case SERVER_ARGS_INIT :                                 // HTTP args item read init
+      if ( _conn->argsCount == _maxArgs) { mode = HTTP_REQUEST_ERR; break; }
+      if ( buf[i] == ' ') { buf[i] = 0; mode = HTTP_REQUEST_ERR; break; }
+      _conn->args[ _conn->argsCount  ].value = NULL;        // no value (yet)
+      _conn->args[ _conn->argsCount++].label = buf + i;     // store label
+      mode = SERVER_ARGS_LOOP;                              // no break = include current char in read loop
+
+    case SERVER_ARGS_LOOP :                                 // HTTP args item read loop
+      if ( buf[i] == '=') { buf[i] = 0; mode = SERVER_ARGS_NEXT; break; }
+      if ( buf[i] == '&') { buf[i] = 0; mode = SERVER_ARGS_INIT; break; }
+      if ( buf[i] == ' ') { buf[i] = 0; mode = SERVER_HTTP_INIT; break; }
+      if ( buf[i] == '\r' || buf[i] == '\n') { mode = HTTP_REQUEST_ERR; break; }
+      break;                                                // break = next char
+
+    case SERVER_ARGS_NEXT :                                 // HTTP args item goto next
+      _conn->args[ _conn->argsCount - 1].value = buf + i;   // store value
+      mode = SERVER_ARGS_LOOP;
+      break;                                                // break = next char
+
+    case SERVER_HTTP_INIT :                                 // HTTP version read init
+      _conn->version = buf + i;                             // store version
+      mode = SERVER_HTTP_LOOP;                              // no break = include current char in read loop
+
+    case SERVER_HTTP_LOOP :                                 // HTTP version read loop
+      if ( buf[i] != '\r' && buf[i] != '\n') break;        // break = next char
+
+      mode = ( buf[i] == '\r') ? SERVER_HTTP_DONE : SERVER_HEAD_INIT;
+      buf[i] = 0;                                           // end of version = end of request line
+      _conn->version  += strncmp( _conn->version, "HTTP/", 5) ? strlen( _conn->version) : 5;
+      _conn->keepAlive = strCmp( _conn->version, "1.1");    // persistent session (default for HTTP/1.1)
+      break;
+
+    case SERVER_HTTP_DONE :                                 // HTTP version read done
+      if ( buf[i] == '\n') { buf[i] = 0; mode = SERVER_HEAD_INIT; break; }
+      mode = HTTP_REQUEST_ERR;
+      break;                                                // break = next char
+
+    case SERVER_HEAD_INIT :                                 // HTTP header line read init
+      _conn->line = i;                                      // store start of header line
+      if ( buf[i] == '\r') { mode = SERVER_HEAD_LAST; break; }
+      if ( buf[i] == '\n') { mode = SERVER_HEAD_DONE; break; }
+      mode = SERVER_HEAD_LOOP;                              // no break = include current char in read loop
+
+    case SERVER_HEAD_LOOP :                                 // HTTP header line read loop
+      if ( buf[i] != '\n') break;                           // break = next char
+
+      buf[i] = 0;                                           // terminate header line
+      if (( i > _conn->line) && ( buf[i - 1] == '\r')) buf[i - 1] = 0;
+      mode = SERVER_HEAD_INIT;
+
+      if ( _parseHeader( buf + _conn->line)) break;         // handle header line (indexed = keep)
+
+      memmove( buf + _conn->line, buf + i + 1, _conn->count - i);
+      _conn->count -= i + 1 - _conn->line;                  // drop handled header line from buffer
+      i    = _conn->line - 1;                               // continue at start of next line
+      break;
+
+    case SERVER_HEAD_LAST :                                 // HTTP empty header line read
+      if ( buf[i] == '\n') { mode = SERVER_HEAD_DONE; break; }
+      mode = HTTP_REQUEST_ERR;
+      break;                                                // break = next char
+    }
+  }
+
+  _conn->mode   = mode;                                     // store parser state for next call
+  _conn->parsed = i;
+
+  if ( mode == HTTP_REQUEST_ERR) return PARSE_ERROR;        // invalid request
+
+  if ( mode != SERVER_HEAD_DONE) {                          // if request not complete (yet)
+    if ( _conn->count < _bufferSize - 1) return PARSE_NEED_MORE;
+
+    _conn->error = ( mode < SERVER_HEAD_INIT) ? 414 : 431;  // buffer full = request line / header too long
+    return PARSE_ERROR;
+  }
+
+  _conn->used = i;                                          // length of request (body / pipelined data follows)
+
+  if ( _conn->body == BODY_ERROR) return PARSE_ERROR;       // unsupported transfer encoding
+
+  #ifdef SIMPLE_WEBSERVER_DEBUG
+  VALUE( _conn->method); VALUE( _conn->version) LF;
+
+  VALUE( _conn->pathCount);
+  for ( int i = 0; i < _conn->pathCount; i++) {
+    VALUE( _conn->path[i]);
+  } LF;
+
+  VALUE( _conn->argsCount);
+  for ( int i = 0; i < _conn->argsCount; i++) {
+    VALUE( _conn->args[i].label); VALUE( _conn->args[i].value);
+  } LF;
+  #endif
+
+  return PARSE_COMPLETE;
+}
+
+// handle request header line (e.g. "Connection: close"), true = header line kept in header index
+bool SimpleWebServerCore::_parseHeader( char* line)
+{
+  char*    value = strchr( line, ':');                      // separator between label and value
+  uint16_t hash  = 0;                                       // hash of label
+
+  if ( !value) return false;                                // ignore malformed header line
+
+  *value++ = 0;                                             // terminate label
+  while ( *value == ' ') value++;                           // skip leading spaces
+  hash = HTTP_Hash( line);
+
+  switch ( hash) {                                          // headers handled by server itself
+  case HTTP_Hash( "Connection") :                           // persistent session requested / refused
+    if ( strcasecmp( line, "Connection")) break;
+    if ( !strncasecmp( value, "close"     ,  5)) _conn->keepAlive = false;
+    if ( !strncasecmp( value, "keep-alive", 10)) _conn->keepAlive = true;
+    break;
+
+  case HTTP_Hash( "Content-Length") :                       // request has a body
+    if ( strcasecmp( line, "Content-Length") || ( _conn->body != BODY_NONE)) break;
+    _conn->bodyLeft = strtoul( value, NULL, 10);
+    if ( _conn->bodyLeft) _conn->body = BODY_DATA;
+    break;
+
+  case HTTP_Hash( "Transfer-Encoding") :                    // request has a chunked body (overrules Content-Length)
+    if ( strcasecmp( line, "Transfer-Encoding")) break;
+    if ( !strstr( value, "chunked")) { _conn->error = 501; _conn->body = BODY_ERROR; break; }
+    _conn->body     = BODY_SIZE;
+    _conn->bodyLeft = 0;
+    break;
+
+  case HTTP_Hash( "Expect") :                               // client waits before sending body
+    if ( strcasecmp( line, "Expect")) break;
+    _conn->expect = !strncasecmp( value, "100-continue", 12);
+    break;
+  }
+
+#if MAX_HEADCOUNT
+  if ( _conn->headCount == MAX_HEADCOUNT) return false;     // header index full
+
+  for ( size_t i = 0; i < sizeof( headerList) / sizeof( headerList[ 0]); i++) {
+    if ( pgm_read_word( headerList + i) == hash) {          // if header is in header list
+      _conn->heads[ _conn->headCount  ].hash  = hash;
+      _conn->heads[ _conn->headCount  ].label = line;       // store label
+      _conn->heads[ _conn->headCount++].value = value;      // store value
+      return true;
+    }
+  }
+#endif
+
+  return false;                                             // header not indexed
+}
+
+// send response header to client (code, content size, content type)
+void SimpleWebServerCore::_sendHeader( int code, const char* content_type, size_t size)
+{
+  _sendPending();                                           // header of respond( code) comes first
+
+  if ( !_conn->client.connected() || _conn->header) return; // check if header can be send
+
+  if (( size == HTTP_SIZE_UNKNOWN) || ( _conn->requests + 1 >= HTTP_KEEPALIVE_MAX)) {
+    _conn->keepAlive = false;                               // end of content = end of session
+  }
+
+  _conn->length = size;                                     // announced content size
+  _conn->sent   = 0;
+  _conn->status = code;                                     // response code (as sent)
+
+  if ( _conn->cache && ( code == 200) && ( size < HTTP_SIZE_CHUNKED)) _cacheBegin( size);
+                                                            // store cachable response
+
+  if ( !_sendHeaderBlock( code, content_type)) {            // no prebuilt header = build it
+    _sendHeaderBegin(  code);
+    _sendHeaderValue( F( "User-Agent")     , F( "Arduino-ethernet"));
+    _sendHeaderValue( F( "Content-Type")   , content_type ? content_type : "text/html");
+  }
+
+  if ( size == HTTP_SIZE_CHUNKED) {
+    _sendHeaderValue( F( "Transfer-Encoding"), F( "chunked"));
+  } else if (( size != HTTP_SIZE_UNKNOWN) && ( code != 204) && ( code != 304)) {
+    _sendHeaderValue( F( "Content-Length") , dec( size));
+  }
+
+  if ( _conn->etag) {                                       // entity tag (for If-None-Match)
+    _sendHeaderValue( F( "ETag")           , _conn->etag);
+  }
+
+  if ( _conn->gzip) {                                       // content is gzip compressed
+    _sendHeaderValue( F( "Content-Encoding"), F( "gzip"));
+  }
+
+  if ( _conn->vary) {                                       // content depends on Accept-Encoding
+    _sendHeaderValue( F( "Vary")           , F( "Accept-Encoding"));
+  }
+
+  if (( code == 405) && _conn->allow) {                     // list methods available on path
+    char        allow[40] = "";                             // e.g. "GET, PUT"
+    const char* name      = methodName;
+
+    for ( size_t i = 0; i < sizeof( methodList) / sizeof( methodList[ 0]); i++) {
+      if ( _conn->allow & METHOD_BIT( methodList[ i])) {
+        if ( allow[ 0]) strcat( allow, ", ");
+        strcat_P( allow, name);                             // add method name
+      }
+      name += strlen_P( name) + 1;                          // next method name
+    }
+
+    _sendHeaderValue( F( "Allow")          , allow);
+  }
+
+  if ( _cacheNew) {                                         // header stored (Connection is added when sent)
+    _cacheNew->headSize = _cacheCount - _cacheNew->keySize;
+    _cacheOn = false;
+  }
+
+  _sendHeaderValue( F( "Connection")     , _conn->keepAlive ? F( "keep-alive") : F( "close"));
+  _sendHeaderClose();
+
+  _cacheOn = _cacheNew != NULL;                             // store content
+}
+
+// send prebuilt status line + fixed headers (code, content type), false if not available
+bool SimpleWebServerCore::_sendHeaderBlock( int code, const char* content_type)
+{
+  uint8_t     type = 0;                                     // index of content type
+  const char* name = typeName;
+
+  if ( content_type) {                                      // default = text/html (type 0)
+    while ( strcmp_P( content_type, name)) {
+      name += strlen_P( name) + 1;                          // next content type
+      if ( ++type == HEADER_JSON + 1) return false;         // content type without header blocks
+    }
+  }
+
+  for ( size_t i = 0; i < sizeof( headerBlocks) / sizeof( headerBlocks[ 0]); i++) {
+    if (( pgm_read_word( &headerBlocks[ i].code) == code) &&
+        ( pgm_read_byte( &headerBlocks[ i].type) == type)) {
+      _write_P( (PGM_P) pgm_read_ptr( &headerBlocks[ i].block), pgm_read_byte( &headerBlocks[ i].size));
+      return true;                                          // header block sent (single copy)
+    }
   }
+
+  return false;
 }
 
-// remove Webserver task
-SimpleWebServerTask::~SimpleWebServerTask()
+// send heade start line (e.g. HTTP/1.1 200 OK)
+void SimpleWebServerCore::_sendHeaderBegin( int code)
 {
-  if ( _device) free( _device);                             // destroy device string
+  CPRINT( F( "HTTP/1.1 ")); CPRINT( dec( code));            // send HTTP/1.1 line
+  CPRINT( " "); CPRINT( HTTP_CodeMessage( code));           // e.g. HTTP/1.1 200 OK
+  CPRINT( F( "\r\n"));                                      // next line
 }
 
-// return targeted device
-const char* SimpleWebServerTask::device()
+// send header key value pair (e.g. label: value)
+void SimpleWebServerCore::_sendHeaderValue( const char* label, const char* value)
 {
-  return _device;                                           // return device
+  CPRINT( label); CPRINT( ": "); CPRINT( value);
+  CPRINT( F( "\r\n"));                                      // next line
 }
 
-// return targeted method
-HTTPMethod SimpleWebServerTask::method()
+// send header key value pair (e.g. label: value)
+void SimpleWebServerCore::_sendHeaderValue( const __FlashStringHelper* label, const char* value)
 {
-  return _method;                                           // return method
+  CPRINT( label); CPRINT( ": "); CPRINT( value);
+  CPRINT( F( "\r\n"));                                      // next line
 }
 
-// create server instance (default port = 80)
-SimpleWebServer::SimpleWebServer( char* name, int port)
-: SimpleTaskList()
-, _name  ( name)
-, _port  ( port)
-, _server( port)
+// send header key value pair (e.g. label: value)
+void SimpleWebServerCore::_sendHeaderValue( const __FlashStringHelper* label, const __FlashStringHelper* value)
 {
+  CPRINT( label); CPRINT( ": "); CPRINT( value);
+  CPRINT( F( "\r\n"));                                      // next line
 }
 
-// start webserver
-void SimpleWebServer::begin()
+// send enf of content message
+void SimpleWebServerCore::_sendHeaderClose()
 {
-  _server.begin();                                          // ethernet server begin
+  CPRINT( F( "\r\n"));                                      // next line
 }
 
-// return server name
-char* SimpleWebServer::name()
+// send content to client (content)
+void SimpleWebServerCore::_sendContent( const char* content)
 {
-  return _name;                                             // return name
+  if ( !_conn->client.connected()) return;                  // check if client still active
+
+  _sendPending();                                           // send header of respond( code) first
+
+  size_t size = strlen( content);                           // size of content
+
+  if ( _conn->chunked) { writeChunk( content, size); return; }
+                                                            // chunked response = send as chunk
+  _write( content, size);                                   // send content
+  _conn->sent += size;                                      // track content size
 }
 
-// return server port number
-word SimpleWebServer::port()
+// send content to client (FLASH content)
+void SimpleWebServerCore::_sendContent( const __FlashStringHelper* content)
 {
-  return _port;                                             // return port
+  if ( !_conn->client.connected()) return;                  // check if client still active
+
+  _sendContent_P( (PGM_P) content, strlen_P( (PGM_P) content));
 }
 
-// check on incoming connection (true = HTTP request received)
-bool SimpleWebServer::connect()
+// send content to client (FLASH data, size)
+void SimpleWebServerCore::_sendContent_P( PGM_P data, size_t size)
 {
-  _client = _server.available();
+  if ( !_conn->client.connected()) return;                  // check if client still active
 
-  if ( _client) {
+  _sendPending();                                           // send header of respond( code) first
 
-    if ( _client.connected()) {                             // check on active client session
-      strClr( _buffer);                                     // reset buffer
-      while ( !_client.available()) ;                       // wait for incoming client request
-      delay( 50);                                           // provide transmit time for client
-      while (  _client.available()) {                       // read all available client data
-        addChr( _buffer, _client.read(), HTTP_BUFFER_SIZE); // add char to buffer
-      }
+  if ( _conn->chunked) {                                    // chunked response = send as chunks
+    char part[ CHUNK_BLOCK];                                // copy of FLASH data (per block)
+
+    while ( size) {
+      size_t n = size < sizeof( part) ? size : sizeof( part);
+
+      memcpy_P( part, data, n);
+      writeChunk( part, n);
+      data += n;
+      size -= n;
     }
+    return;
+  }
 
-#ifdef SIMPLE_WEBSERVER_DEBUG
-    PRINT( "#####") LF;
-    PRINT( _buffer);                                        // print full HTTP request"
-    PRINT( "#####") LF;
+  _write_P( data, size);                                    // send content (in blocks of HTTP_OUTPUT_SIZE)
+  _conn->sent += size;                                      // track content size
+}
+
+// add data to response buffer (data, size), buffer is sent when full or at end of response
+void SimpleWebServerCore::_write( const char* data, size_t size)
+{
+  if ( _cacheOn) _cacheStore( data, size, false);           // response is being stored in cache
+
+#if HTTP_OUTPUT_SIZE
+  while ( size) {
+#ifndef SIMPLE_WEBSERVER_DEBUG
+    if ( !_outputCount && ( size >= HTTP_OUTPUT_SIZE)) {    // large block = send without copy
+      size_t sent = _send( data, size, false);
+
+      data += sent;                                         // rest (client send buffer full) is buffered
+      size -= sent;
+      if ( !size) return;
+    }
 #endif
+    size_t part = HTTP_OUTPUT_SIZE - _outputCount;          // free space in response buffer
 
-    if ( strlen( _buffer)) return _parseRequest();          // return breakdown HTTP request result
-  }
+    if ( part > size) part = size;
+    memcpy( _output + _outputCount, data, part);            // add data to response buffer
+    _outputCount += part;
+    data         += part;
+    size         -= part;
 
-  return false;                                             // failure: invalid HTTP request
+    if ( _outputCount == HTTP_OUTPUT_SIZE) _flush();        // send full response buffer
+  }
+#else
+  _send( data, size, true);                                 // no response buffer = send as is
+#endif
 }
 
-// close client connection
-void SimpleWebServer::disconnect()
+// add FLASH data to response buffer (data, size)
+void SimpleWebServerCore::_write_P( PGM_P data, size_t size)
 {
-  _clientStop();                                            // stop client session
+  if ( _cacheOn) _cacheStore( data, size, true);            // response is being stored in cache
+
+  while ( size) {
+#if HTTP_OUTPUT_SIZE
+    size_t part = HTTP_OUTPUT_SIZE - _outputCount;          // free space in response buffer
+
+    if ( part > size) part = size;
+    memcpy_P( _output + _outputCount, data, part);          // add data to response buffer
+    _outputCount += part;
+
+    if ( _outputCount == HTTP_OUTPUT_SIZE) _flush();        // send full response buffer
+#else
+    char   block[ CHUNK_BLOCK];                             // no response buffer = copy per block (on stack)
+    size_t part = ( size < sizeof( block)) ? size : sizeof( block);
+
+    memcpy_P( block, data, part);
+    _send( block, part, true);
+#endif
+    data         += part;
+    size         -= part;
+  }
 }
 
-// attach callback function (callback, device, method)
-void  SimpleWebServer::handleOn( TaskFunc func, const char* name, HTTPMethod method)
+// add string to response buffer
+void SimpleWebServerCore::_write( const char* data)
 {
-  SimpleWebServerTask* task = new SimpleWebServerTask( func, name, method);
-                                                            // create new webserver task
-  _attach( task);                                           // attach task to list
+  if ( data) _write( data, strlen( data));
 }
 
-// route incoming requests to the proper callback function
-void SimpleWebServer::handleRequest()
+// add FLASH string to response buffer
+void SimpleWebServerCore::_write( const __FlashStringHelper* data)
 {
-  SimpleWebServerTask* task = (SimpleWebServerTask*) _rootTask;
-                                                            // first task entry in task list
-  while ( task != NULL) {                                   // whlle task entry is valid
-    if ( method( task->method()) && path( 0, task->device())) (*task->func())();
-                                                            // execute callback function
-    task = (SimpleWebServerTask*) task->next();             // next task entry
-  }
+  if ( data) _write_P( (PGM_P) data, strlen_P( (PGM_P) data));
 }
 
-// main E2E loop (from connect to disconnect)
-void SimpleWebServer::handle()
+// send data to client (data, size, true = wait until sent, max HTTP_WRITE_TIMEOUT), returns number of bytes sent
+size_t SimpleWebServerCore::_send( const char* data, size_t size, bool wait)
 {
-  returnCode = 400;                                         // default return code = error
+  unsigned long start = millis();
+  size_t        done  = 0;
 
-  if ( connect()) {                                         // if new request available from client
-    if (( _pathCount == 1) && ( _argsCount == 0) && ( path( 0, ""))) {
-      // returnCode = 200;                                  // HTTP identify
-      respond( returnCode = 200, "text/plain");             // response to client
-      sendLine( name());
-    } else {
-      handleRequest();                                      // handle request
-    }
+  while ( done < size) {
+    size_t sent = _conn->client.write( (const uint8_t*) data + done, size - done);
 
-    respond( returnCode);                                   // send response
-    disconnect();                                           // close client session
+    _metricsBytes( sent, false);
+    done += sent;
 
-    yield();                                                // provide time fpr system tasks
+    if (( done == size) || !wait) break;                    // all sent (or no wait = caller retries later)
+
+    if ( !_conn->client.connected() || ( millis() - start > HTTP_WRITE_TIMEOUT)) {
+      _conn->client.stop();                                 // client gone or too slow = response incomplete,
+      break;                                                // close session (further writes are dropped)
+    }
+    yield();                                                // provide time for system tasks
   }
+
+  return done;
 }
 
-// send response (code = 200 OK)
-void SimpleWebServer::respond( int code)
+// send response buffer to client (true = wait until sent), false = data left in buffer (client send buffer full)
+bool SimpleWebServerCore::_flush( bool wait)
 {
-  _sendHeader( code);                                       // send header with response code
+#if HTTP_OUTPUT_SIZE
+  if ( !_outputCount) return true;                          // nothing to send
+
+#ifdef SIMPLE_WEBSERVER_DEBUG
+  _output[ _outputCount] = 0; PRINT( _output);              // show response on console
+#endif
 
-  _header = true;                                           // true = header was sent
+  size_t sent = _send( _output, _outputCount, wait);
+
+  _outputCount = wait ? 0 : _outputCount - sent;            // waited = sent (or dropped, session is closed)
+  memmove( _output, _output + sent, _outputCount);          // keep unsent rest at buffer start
+
+  return !_outputCount;
+#else
+  (void) wait;                                              // no response buffer (sent by _write)
+  return true;
+#endif
 }
 
-// send response (code, content type, content size)
-void SimpleWebServer::respond( int code, const char* content_type, size_t size)
+// send staged response chunk
+void SimpleWebServerCore::_flushChunk()
 {
-  _sendHeader( code, content_type, size);                   // send header with response code + content type
+#if HTTP_CHUNK_SIZE
+  size_t size = _chunkCount;                                // size of staged chunk
 
-  _header = true;                                           // true = header was sent
+  _chunkCount = 0;                                          // staging area empty
+  if ( size) writeChunk( _chunk, size);                     // send staged chunk
+#endif
 }
 
-// send response (code, content type, content)
-void SimpleWebServer::respond( int code, const char* content_type, const char* content)
+// start chunk framed in response buffer (size line is patched by _frameEnd), only within a chunked response
+void SimpleWebServerCore::_frameBegin()
 {
-  if ( content) {                                           // if valid content
-    _sendHeader ( code, content_type, strlen( content));    // send header (code, content type, content size)
-    _sendContent( content);                                 // send content
+#if FRAME_OUTPUT
+  if ( !_conn->chunked || ( _frameAt != HTTP_SIZE_UNKNOWN)) return;
 
-    _header  = true;                                        // true = header  was sent
-    _content = true;                                        // true = content was sent
-    _newline = true;                                        // true = extra CR/NL required
-  } else {
-    _sendHeader( code, content_type);                       // send header (code, content type)
+  _flushChunk();                                            // send staged content first
 
-    _header  = true;                                        // true = header  was sent
-  }
+  if ( _outputCount + FRAME_HEAD + FRAME_TAIL + 1 > HTTP_OUTPUT_SIZE) _flush();
+                                                            // no room for size line + data = send buffer
+  _frameAt      = _outputCount;                             // reserve size line
+  _outputCount += FRAME_HEAD;
+#endif
 }
 
-// send response (code, content label, content value)
-void SimpleWebServer::sendContent( const char* content)
+// add data to framed chunk (data, size), a full response buffer is closed as chunk and sent
+void SimpleWebServerCore::_frameWrite( const char* data, size_t size)
 {
-  if ( content) {
-    _sendContent( content);                                 // send content
-
-    _content = true;                                        // true = content was sent
-    _newline = true;                                        // true = extra CR/NL required
+#if FRAME_OUTPUT
+  while ( size) {
+    size_t part = HTTP_OUTPUT_SIZE - FRAME_TAIL - _outputCount;
+                                                            // free space in chunk (end of chunk kept free)
+    if ( part > size) part = size;
+    memcpy( _output + _outputCount, data, part);            // add data to response buffer
+    _outputCount += part;
+    _conn->sent  += part;                                   // track content size
+    data         += part;
+    size         -= part;
+
+    if ( _outputCount == HTTP_OUTPUT_SIZE - FRAME_TAIL) {   // chunk full = close, send and start next chunk
+      _frameEnd();
+      _flush();
+      _frameBegin();
+    }
   }
+
+  _conn->content = true;                                    // true = content was sent
+#else
+  (void) data; (void) size;                                 // no response buffer (write() uses chunk path)
+#endif
 }
 
-// send response (code, content label, content value)
-void SimpleWebServer::sendLine( const char* label, const char* value)
+// close framed chunk (patch size line, add end of chunk), an empty chunk is dropped
+void SimpleWebServerCore::_frameEnd()
 {
-  if ( label) _sendContent( label);                         // if valid label send label
-  if ( value) _sendContent( value);                         // if valid label send value
+#if FRAME_OUTPUT
+  if ( _frameAt == HTTP_SIZE_UNKNOWN) return;               // no framed chunk
 
-  _sendContent( "\r\n");                                    // send end of line message
+  size_t size = _outputCount - _frameAt - FRAME_HEAD;       // chunk data size
+  char*  line = _output + _frameAt;
+
+  if ( size) {
+    for ( int i = FRAME_HEAD - 3; i >= 0; i--, size >>= 4) {
+      line[ i] = "0123456789abcdef"[ size & 0x0F];          // chunk size (4 hex digits, leading zeros)
+    }
+    line[ FRAME_HEAD - 2]    = '\r';                        // end of size line
+    line[ FRAME_HEAD - 1]    = '\n';
+    _output[ _outputCount++] = '\r';                        // end of chunk
+    _output[ _outputCount++] = '\n';
+  } else {
+    _outputCount = _frameAt;                                // empty chunk would end the response
+  }
 
-  _content = true;                                          // true = content was sent
-  _newline = false;                                         // true = extra CR/NL required
+  _frameAt = HTTP_SIZE_UNKNOWN;
+#endif
 }
 
-// send response (code, content label, content value)
-void SimpleWebServer::sendLine( const __FlashStringHelper* label, const char* value)
+// build cache key of request (e.g. "/relays/3?state=on") in key buffer (HTTP_PATH_SIZE), returns size (0 = too long)
+size_t SimpleWebServerCore::_cacheKey( char* key)
 {
-  if ( label) _sendContent( label);                         // if valid label send label
-  if ( value) _sendContent( value);                         // if valid label send value
+  size_t size = 0;
 
-  _sendContent( "\r\n");                                    // send end of line message
+  for ( int i = 0; i < _conn->pathCount + _conn->argsCount; i++) {
+    bool        arg   = i >= _conn->pathCount;              // path item or argument
+    const char* label = arg ? _conn->args[ i - _conn->pathCount].label : _conn->path[ i];
+    const char* value = arg ? _conn->args[ i - _conn->pathCount].value : NULL;
+    size_t      need  = strlen( label) + ( value ? strlen( value) + 1 : 0) + 1;
 
-  _content = true;                                          // true = content was sent
-  _newline = false;                                         // true = extra CR/NL required
-}
+    if ( size + need >= HTTP_PATH_SIZE) return 0;           // key too long = not cached
 
-// return full HTTP request
-char* SimpleWebServer::request()
-{
-  return _buffer;                                           // return HTTP request
-}
+    key[ size++] = !arg ? '/' : ( i == _conn->pathCount) ? '?' : '&';
+    strcpy( key + size, label); size += strlen( label);
 
-// return method of HTTP request
-HTTPMethod SimpleWebServer::method()
-{
-  return _method;                                           // return HTTP method
+    if ( value) {
+      key[ size++] = '=';
+      strcpy( key + size, value); size += strlen( value);
+    }
+  }
+
+  key[ size] = 0;
+  return size;
 }
 
-// true = active method equals targeted method
-bool SimpleWebServer::method( HTTPMethod method)
+// send cached response for GET request (false = not cached, response may be stored)
+bool SimpleWebServerCore::_cacheSend()
 {
-  return (( method == HTTP_ANY) || ( method == _method));   // verify valid method
+  if ( !_cacheBudget || ( _conn->method != HTTP_GET)) return false;
+
+  char         key[ HTTP_PATH_SIZE];                        // cache key of request
+  size_t       size = _cacheKey( key);
+  uint16_t     hash = HTTP_Hash( key);
+  cacheEntry** link = &_cacheList;
+
+  if ( !size) return false;                                 // key too long
+
+  while ( *link) {
+    cacheEntry* entry = *link;
+
+    if (( entry->hash == hash) && ( entry->keySize == size) && !memcmp( entry->data, key, size)) {
+      *link       = entry->next;                            // move entry to front (most recently used)
+      entry->next = _cacheList;
+      _cacheList  = entry;
+
+      if ( _conn->requests + 1 >= HTTP_KEEPALIVE_MAX) _conn->keepAlive = false;
+
+      _conn->length = _conn->sent = entry->bodySize;        // content is sent completely
+      _conn->header = _conn->content = true;
+      _conn->status = 200;
+
+      _write( entry->data + size, entry->headSize);         // send stored header
+      _sendHeaderValue( F( "Connection")     , _conn->keepAlive ? F( "keep-alive") : F( "close"));
+      _sendHeaderClose();
+      _write( entry->data + size + entry->headSize, entry->bodySize);
+                                                            // send stored content
+      return true;
+    }
+
+    link = &entry->next;
+  }
+
+  _conn->cache = true;                                      // not cached = store response
+  return false;
 }
 
-// return number of (recognized) path items
-int SimpleWebServer::pathCount()
+// start storing response in new cache entry (content size)
+void SimpleWebServerCore::_cacheBegin( size_t size)
 {
-  return _pathCount;                                        // return number of items in path array
+  char   key[ HTTP_PATH_SIZE];                              // cache key of request
+  size_t keySize = _cacheKey( key);
+  size_t max     = keySize + HTTP_CACHE_HEAD + size;        // max size of key + header + content
+
+  if ( !keySize || ( sizeof( cacheEntry) + max > _cacheBudget)) return;
+                                                            // response does not fit in cache
+  _cacheNew = (cacheEntry*) malloc( sizeof( cacheEntry) + max);
+
+  if ( !_cacheNew) return;                                  // out of memory = not cached
+
+  _cacheNew->next     = NULL;
+  _cacheNew->hash     = HTTP_Hash( key);
+  _cacheNew->keySize  = keySize;
+  _cacheNew->headSize = 0;
+  _cacheNew->bodySize = size;
+  memcpy( _cacheNew->data, key, keySize);                   // store key
+
+  _cacheCount = keySize;
+  _cacheMax   = max;
+  _cacheOn    = true;                                       // store header + content
 }
 
-// returns value of HTTP path at index i
-const char* SimpleWebServer::path( uint8_t i)
+// store response output in new cache entry (data, size, true = FLASH data)
+void SimpleWebServerCore::_cacheStore( const char* data, size_t size, bool flash)
 {
-  return ( i < _pathCount) ? _path[ i] : NULL;
-}                                                           // return path item at index i
+  if ( !_cacheNew) return;                                  // no response being stored
 
-// checks if pathItem exists at index i
-bool SimpleWebServer::path( uint8_t i, const char* pathItem)
-{
-  return ( i < _pathCount) ? strCmp( pathItem, _path[ i]) : false;
-}                                                           // return true if pathItem exists
+  if ( _cacheCount + size > _cacheMax) {                    // larger than announced = not cached
+    free( _cacheNew);
+    _cacheNew = NULL;
+    _cacheOn  = false;
+    return;
+  }
 
-// return number of (recognized) arguments
-int SimpleWebServer::argsCount()
-{
-  return _argsCount;                                        // return number of items in args array
+  if ( flash) memcpy_P( _cacheNew->data + _cacheCount, data, size);
+  else        memcpy  ( _cacheNew->data + _cacheCount, data, size);
+
+  _cacheCount += size;
 }
 
-// return value of argument with a specfic label
-const char* SimpleWebServer::arg( const char* label)
+// add stored response to cache (evict least recently used entries to stay in budget)
+void SimpleWebServerCore::_cacheEnd()
 {
-  for ( int i = 0; i < _argsCount; i++) {                   // for all args items
-    if ( strCmp( _args[ i].label, label)) {                 // if label exists
-      return _args[ i].value ? _args[ i].value : _args[ i].label;
-    }                                                      // return value at index i
+  cacheEntry* entry = _cacheNew;
+
+  _cacheNew = NULL;
+  _cacheOn  = false;
+
+  if ( !entry) return;                                      // no response stored
+
+  if ( _cacheCount != entry->keySize + entry->headSize + entry->bodySize) {
+    free( entry);                                           // response incomplete = not cached
+    return;
   }
 
-  return NULL;
-}
+  size_t      size = sizeof( cacheEntry) + _cacheCount;     // memory used by entry
+  cacheEntry* keep = (cacheEntry*) realloc( entry, size);   // release unused header space
 
-// return true if value of argument with a specfic label exists
-bool SimpleWebServer::arg( const char* label, const char* value)
-{
-  bool found = false;                                       // true = combination found
+  if ( !keep) {                                             // out of memory = not cached
+    free( entry);
+    return;
+  }
+  entry = keep;
+
+  while ( _cacheList && ( _cacheUsed + size > _cacheBudget)) {
+    cacheEntry** link = &_cacheList;                        // evict least recently used entry
 
-  for ( int i = 0; i < _argsCount; i++) {                   // for all args items
-    found |= (( strCmp( _args[i].label, label)) &&
-              ( strCmp( _args[i].value, value)));           // return true if value exists at index i
+    while (( *link)->next) link = &( *link)->next;
+    _cacheFree( *link);
+    *link = NULL;
   }
 
-  return found;                                             // return result
+  entry->next = _cacheList;                                 // add as most recently used
+  _cacheList  = entry;
+  _cacheUsed += size;
 }
 
-// break down HTTP request (e.g. "GET /path/1?arg1=0&arg2=1 HTTP/1.1")
-bool SimpleWebServer::_parseRequest()
+// release cache entry (entry must be unlinked)
+void SimpleWebServerCore::_cacheFree( cacheEntry* entry)
 {
-  char* meth = _buffer;                                     // HTTP method  string
-  char* http = _buffer;                                     // HTTP version string
-  int   mode = SERVER_METH_INIT;                            // state engine value
-  int   leng = strlen( _buffer);                            // length of HTTP request
+  _cacheUsed -= sizeof( cacheEntry) + entry->keySize + entry->headSize + entry->bodySize;
+  free( entry);
+}
 
-  if ( leng == 0) return false;                             // do nothing if empty request
+#if HTTP_METRICS_ROUTES
+static const unsigned long metricsBucket[] = { HTTP_METRICS_BUCKET_LIST };
+                                                            // upper bounds of latency buckets (us)
+static_assert( sizeof( metricsBucket) / sizeof( metricsBucket[ 0]) == HTTP_METRICS_BUCKETS,
+               "HTTP_METRICS_BUCKETS must match number of entries in HTTP_METRICS_BUCKET_LIST");
 
-  _pathCount = 0;                                           // reset number of path items
-  _argsCount = 0;                                           // reset number of argument items
+// print unsigned number (up to 64 bit)
+static void metricsNumber( Print& out, unsigned long long value)
+{
+  char  text[ 21];                                          // max 20 digits + 0
+  char* c = text + sizeof( text) - 1;
 
-  for ( int i = 0; i < leng; i++) {                         // buffer loop
-    switch ( mode) {
-    case SERVER_METH_INIT :                                 // HTTP method read init
-      mode = SERVER_METH_LOOP;                              // no break = include current char in read loop
+  *c = 0;
+  do { *--c = '0' + value % 10; value /= 10; } while ( value);
 
-    case SERVER_METH_LOOP :                                 // HTTP method read loop
-      if ( _buffer[i] == ' ') { _buffer[i] = 0; mode = SERVER_METH_DONE; break; }
-      break;                                                // break = next char
+  out.print( c);
+}
 
-    case SERVER_METH_DONE :                                 // HTTP method read done
-      if ( _buffer[i] == '/') { _buffer[i] = 0; mode = SERVER_PATH_INIT; break; }
-      mode = HTTP_BAD_REQUEST;
-      break;                                                // break = next char
+// print microseconds as seconds (e.g. "0.000250")
+static void metricsSeconds( Print& out, unsigned long long us)
+{
+  char text[ 8];                                            // "." + 6 digits + 0
 
-    case SERVER_PATH_INIT :                                 // HTTP path item read init
-      if ( _pathCount == MAX_PATHCOUNT)       { mode = HTTP_BAD_REQUEST; break; }
-      _path[ _pathCount++] = _buffer + i;
-      mode = SERVER_PATH_LOOP;                              // no break = include current char in read loop
+  metricsNumber( out, us / 1000000);
+  sprintf( text, ".%06lu", (unsigned long) ( us % 1000000));
+  out.print( text);
+}
 
-    case SERVER_PATH_LOOP :                                 // HTTP path item read loop
-      if ( _buffer[i] == '/') { _buffer[i] = 0; mode = SERVER_PATH_INIT; break; }
-      if ( _buffer[i] == '?') { _buffer[i] = 0; mode = SERVER_ARGS_INIT; break; }
-      if ( _buffer[i] == ' ') { _buffer[i] = 0; mode = SERVER_HTTP_INIT; break; }
-      break;                                                // break = next char
+// print label value (text, true = PROGMEM), '"' and '\' are escaped
+static void metricsText( Print& out, const char* text, bool flash)
+{
+  for ( char c; ( c = flash ? pgm_read_byte( text) : *text); text++) {
+    if (( c == '"') || ( c == '\\')) out.print( '\\');
+    out.print( c);
+  }
+}
 
-    case SERVER_PATH_DONE :                                 // HTTP path item read done
-    case SERVER_ARGS_INIT :                                 // HTTP args item read init
-      if ( _argsCount == MAX_ARGSCOUNT)       { mode = HTTP_BAD_REQUEST; break; }
-      if ( _buffer[i] == ' ') { _buffer[i] = 0; mode = HTTP_BAD_REQUEST; break; }
-      _args[ _argsCount++  ].label = _buffer + i;           // store label
-      mode = SERVER_ARGS_LOOP;                              // no break = include current char in read loop
+// print method name (HTTP_ANY = "ANY")
+static void metricsMethod( Print& out, HTTPMethod method)
+{
+  const char* name = methodName;
 
-    case SERVER_ARGS_LOOP :                                 // HTTP args item read loop
-      if ( _buffer[i] == '=') { _buffer[i] = 0; mode = SERVER_ARGS_NEXT; break; }
-      if ( _buffer[i] == '&') { _buffer[i] = 0; mode = SERVER_ARGS_INIT; break; }
-      if ( _buffer[i] == ' ') { _buffer[i] = 0; mode = SERVER_HTTP_INIT; break; }
-      break;                                                // break = next char
+  for ( size_t i = 0; i < sizeof( methodList) / sizeof( methodList[ 0]); i++) {
+    if ( methodList[ i] == method) { out.print(( const __FlashStringHelper*) name); return; }
+    name += strlen_P( name) + 1;                            // next method name
+  }
 
-    case SERVER_ARGS_NEXT :                                 // HTTP args item goto next
-      _args[ _argsCount - 1].value = _buffer + i;           // store value
-      mode = SERVER_ARGS_LOOP;
-      break;                                                // break = next char
+  out.print( F( "ANY"));
+}
 
-    case SERVER_HTTP_INIT :                                 // HTTP version read done
-      http = _buffer + i;                                   // store version
-      mode = SERVER_HTTP_LOOP;                              // no break = include current char in read loop
+// send metrics if metrics path is requested (false = other path)
+bool SimpleWebServerCore::_metricsServe()
+{
+  if ( !_metricsPath || ( _conn->method != HTTP_GET)) return false;
 
-    case SERVER_HTTP_LOOP :                                 // HTTP version read loop
-      if ( _buffer[i] == '\r') { _buffer[i] = 0;  mode = SERVER_HTTP_DONE; break; }
-      break;                                                // break = next char
+  const char* match = _metricsPath;
 
-    case SERVER_HTTP_DONE :                                 // HTTP version read done
-      break;
+  for ( int n = 0; match && ( n < _conn->pathCount); n++) {
+    size_t size = strlen( _conn->path[ n]);                 // compare full path with path items
 
-    case HTTP_BAD_REQUEST :                                 // onvalid HTTP request
-      break;
-    }
+    match = (( *match == '/') && !strncmp( match + 1, _conn->path[ n], size)) ? match + size + 1 : NULL;
   }
 
-  _header  = false;                                         // true = header  was sent
-  _content = false;                                         // true = content was sent
-  _newline = false;                                         // true = extra CR/NL required
+  if ( !match || *match) return false;                      // path differs
+
+  _metricsRoute( _metricsPath, false);
+  beginChunked( 200, "text/plain; version=0.0.4");          // Prometheus text format
+  _frameBegin();                                            // frame chunks at response buffer size
+
+  for ( int line = -1; line <= HTTP_METRICS_BUCKETS + 2; line++) {
+                                                            // line -1 = total, 0..BUCKETS = bucket, then sum + count
+    if ( line == -1) print( F( "# HELP http_requests_total Requests per route and method.\n"
+                               "# TYPE http_requests_total counter\n"));
+    if ( line ==  0) print( F( "# HELP http_request_duration_seconds Time from complete request to sent response.\n"
+                               "# TYPE http_request_duration_seconds histogram\n"));
+
+    for ( int i = 0; i <= HTTP_METRICS_ROUTES; i++) {       // for all routes (last = other routes)
+      metricsRoute* route = _metricsRoutes + i;
+      unsigned long total = 0;                              // requests of route
+      unsigned long value = 0;                              // cumulative requests up to bucket of line
+
+      if (( i >= _metricsRouteCount) && ( i < HTTP_METRICS_ROUTES)) continue;
+                                                            // skip unused entries
+      for ( int b = 0; b <= HTTP_METRICS_BUCKETS; b++) {
+        total += route->count[ b];
+        if ( b <= line) value = total;
+      }
 
-  _method = HTTP_ANY;                                       // determine method index
-  if ( strCmp( meth, "GET"    )) { _method = HTTP_GET;     } else
-  if ( strCmp( meth, "POST"   )) { _method = HTTP_POST;    } else
-  if ( strCmp( meth, "DELETE" )) { _method = HTTP_DELETE;  } else
-  if ( strCmp( meth, "OPTIONS")) { _method = HTTP_OPTIONS; } else
-  if ( strCmp( meth, "PUT"    )) { _method = HTTP_PUT;     } else
-  if ( strCmp( meth, "PATCH"  )) { _method = HTTP_PATCH;   }
-  _version = http + 5;                                      // strClr( vers_s + 5);
+      if ( !total) continue;                                // no requests
+      if (( line < 0) || ( line > HTTP_METRICS_BUCKETS)) value = total;
+      if      ( line == -1)                       print( F( "http_requests_total{route=\""));
+      else if ( line <= HTTP_METRICS_BUCKETS)     print( F( "http_request_duration_seconds_bucket{route=\""));
+      else if ( line == HTTP_METRICS_BUCKETS + 1) print( F( "http_request_duration_seconds_sum{route=\""));
+      else                                        print( F( "http_request_duration_seconds_count{route=\""));
+
+      if      ( i == HTTP_METRICS_ROUTES) print( F( "(other)"));
+      else if ( !route->label)            print( F( "(none)"));
+      else    metricsText( *this, route->label, route->flash);
+
+      print( F( "\",method=\""));
+      if ( i == HTTP_METRICS_ROUTES) print( F( "ANY"));
+      else metricsMethod( *this, route->method);
+      print( '"');
+
+      if (( line >= 0) && ( line <= HTTP_METRICS_BUCKETS)) {
+        print( F( ",le=\""));
+        if ( line < HTTP_METRICS_BUCKETS) metricsSeconds( *this, metricsBucket[ line]);
+        else print( F( "+Inf"));
+        print( '"');
+      }
 
-  #ifdef SIMPLE_WEBSERVER_DEBUG
-  VALUE( _method); VALUE( _version) LF;
+      print( F( "} "));
+      if ( line == HTTP_METRICS_BUCKETS + 1) metricsSeconds( *this, route->micros);
+      else metricsNumber( *this, value);
+      print( '\n');
+    }
+  }
 
-  VALUE( _pathCount);
-  for ( int i = 0; i < _pathCount; i++) {
-    VALUE( _path[i]);
-  } LF;
+  print( F( "# HELP http_responses_total Responses per status code.\n"
+            "# TYPE http_responses_total counter\n"));
 
-  VALUE( _argsCount);
-  for ( int i = 0; i < _argsCount; i++) {
-    VALUE( _args[i].label); VALUE( _args[i].value);
-  } LF;
-  #endif
+  for ( int i = 0; i <= HTTP_METRICS_STATUS; i++) {         // for all codes (last = other codes)
+    if ((( i >= _metricsStatusCount) && ( i < HTTP_METRICS_STATUS)) || !_metricsStatus[ i].count) continue;
+
+    print( F( "http_responses_total{code=\""));
+    if ( i < HTTP_METRICS_STATUS) print( _metricsStatus[ i].code);
+    else print( F( "other"));
+    print( F( "\"} "));
+    metricsNumber( *this, _metricsStatus[ i].count);
+    print( '\n');
+  }
 
-  return ( mode != HTTP_BAD_REQUEST);
+  print( F( "# HELP http_request_bytes_total Bytes received from clients.\n"
+            "# TYPE http_request_bytes_total counter\n"
+            "http_request_bytes_total "));
+  metricsNumber( *this, _metricsBytesIn);
+  print( F( "\n# HELP http_response_bytes_total Bytes sent to clients.\n"
+            "# TYPE http_response_bytes_total counter\n"
+            "http_response_bytes_total "));
+  metricsNumber( *this, _metricsBytesOut);
+  print( F( "\n# HELP http_parse_errors_total Invalid requests (rejected before routing).\n"
+            "# TYPE http_parse_errors_total counter\n"
+            "http_parse_errors_total "));
+  metricsNumber( *this, _metricsErrors);
+  print( '\n');
+  _frameEnd();                                              // close last chunk
+
+  return true;
 }
 
-#ifdef SIMPLE_WEBSERVER_DEBUG
-#define CPRINT(S) _client.print(S); PRINT(S);
-#else
-#define CPRINT(S) _client.print(S);
-#endif
+// start metrics of active request (request is complete)
+void SimpleWebServerCore::_metricsBegin()
+{
+  _metricsLabel = NULL;                                     // route not known yet
+  _metricsFlash = false;
+  _metricsStart = micros();
+}
 
-// send response header to client (code, content size, content type)
-void SimpleWebServer::_sendHeader( int code, const char* content_type, size_t size)
+// set route of active request (label, true = PROGMEM), first route executed is kept
+void SimpleWebServerCore::_metricsRoute( const char* label, bool flash)
 {
-  if ( !_client.connected() || _header) return;             // check if header can be send
+  if ( _metricsLabel) return;                               // route already set (e.g. all matching callbacks)
 
-  _sendHeaderBegin(  code);
-  _sendHeaderValue( F( "User-Agent")     , F( "Arduino-ethernet"));
-  _sendHeaderValue( F( "Content-Type")   , content_type ? content_type : "text/html");
+  _metricsLabel = label;
+  _metricsFlash = flash;
+}
 
-  if ( size) {
-    _sendHeaderValue( F( "Content-Length") , dec( size));
+// count response code (table full = other codes)
+void SimpleWebServerCore::_metricsCount( int code)
+{
+  int i = 0;
+
+  while (( i < _metricsStatusCount) && ( _metricsStatus[ i].code != code)) i++;
+
+  if ( i == _metricsStatusCount) {                          // new code
+    if ( i < HTTP_METRICS_STATUS) { _metricsStatus[ i].code = code; _metricsStatus[ i].count = 0; _metricsStatusCount++; }
+    else i = HTTP_METRICS_STATUS;                           // table full = other codes
   }
 
-  _sendHeaderValue( F( "User-Connection"), F( "close"));
-  _sendHeaderClose();
+  _metricsStatus[ i].count++;
 }
 
-// send heade start line (e.g. HTTP/1.1 200 OK)
-void SimpleWebServer::_sendHeaderBegin( int code)
+// add active request to metrics (latency, route, response code)
+void SimpleWebServerCore::_metricsEnd()
 {
-  if ( !_client.connected()) return;                        // check if client still active
+  unsigned long us = micros() - _metricsStart;              // latency (request complete until response sent)
+  int           i  = 0;
+  int           b  = 0;
+
+  while (( i < _metricsRouteCount) && (( _metricsRoutes[ i].label  != _metricsLabel) ||
+                                       ( _metricsRoutes[ i].method != _conn->method))) i++;
+
+  if ( i == _metricsRouteCount) {                           // new route
+    if ( i < HTTP_METRICS_ROUTES) {
+      memset( _metricsRoutes + i, 0, sizeof( metricsRoute));
+      _metricsRoutes[ i].label  = _metricsLabel;
+      _metricsRoutes[ i].flash  = _metricsFlash;
+      _metricsRoutes[ i].method = _conn->method;
+      _metricsRouteCount++;
+    } else {
+      i = HTTP_METRICS_ROUTES;                              // table full = other routes
+    }
+  }
 
-  CPRINT( F( "HTTP/1.1 ")); CPRINT( code);                  // send HTTP/1.1 line
-  CPRINT( " "); CPRINT( HTTP_CodeMessage( code));           // e.g. HTTP/1.1 200 OK
-  CPRINT( F( "\r\n"));                                      // next line
-}
+  while (( b < HTTP_METRICS_BUCKETS) && ( us > metricsBucket[ b])) b++;
 
-// send header key value pair (e.g. label: value)
-void SimpleWebServer::_sendHeaderValue( const char* label, const char* value)
-{
-  if ( !_client.connected()) return;                        // check if client still active
+  _metricsRoutes[ i].count[ b]++;                           // count request in latency bucket
+  _metricsRoutes[ i].micros += us;
 
-  CPRINT( label); CPRINT( ": "); CPRINT( value);
-  CPRINT( F( "\r\n"));                                      // next line
+  _metricsCount( _conn->status);
 }
 
-// send header key value pair (e.g. label: value)
-void SimpleWebServer::_sendHeaderValue( const __FlashStringHelper* label, const char* value)
+// count invalid request (response code)
+void SimpleWebServerCore::_metricsError( int code)
 {
-  if ( !_client.connected()) return;                        // check if client still active
-
-  CPRINT( label); CPRINT( ": "); CPRINT( value);
-  CPRINT( F( "\r\n"));                                      // next line
+  _metricsErrors++;
+  _metricsCount( code);
 }
 
-// send header key value pair (e.g. label: value)
-void SimpleWebServer::_sendHeaderValue( const __FlashStringHelper* label, const __FlashStringHelper* value)
+// count bytes (size, true = received from client)
+void SimpleWebServerCore::_metricsBytes( size_t size, bool in)
 {
-  if ( !_client.connected()) return;                        // check if client still active
-
-  CPRINT( label); CPRINT( ": "); CPRINT( value);
-  CPRINT( F( "\r\n"));                                      // next line
+  if ( in) _metricsBytesIn  += size;
+  else     _metricsBytesOut += size;
 }
+#else
+bool SimpleWebServerCore::_metricsServe()                   { return false; }
+void SimpleWebServerCore::_metricsBegin()                   {}
+void SimpleWebServerCore::_metricsRoute( const char*, bool) {}
+void SimpleWebServerCore::_metricsCount( int)               {}
+void SimpleWebServerCore::_metricsEnd()                     {}
+void SimpleWebServerCore::_metricsError( int)               {}
+void SimpleWebServerCore::_metricsBytes( size_t, bool)      {}
+#endif
 
-// send enf of content message
-void SimpleWebServer::_sendHeaderClose()
+// send rest of response (without blocking), then keep client session for next request or close it
+void SimpleWebServerCore::_clientNext()
 {
-  if ( !_client.connected()) return;                        // check if client still active
+  endChunked();                                             // close chunked response (if still open)
+  _cacheEnd();                                              // add stored response to cache (if any)
+
+  if ( !_flush( false)) {                                   // client send buffer full = send rest later
+    _conn->timer = millis();                                // start send timer
+    _conn->state = CLIENT_SENDING;                          // (see _advance)
+    _conn->count -= _conn->used;                            // request done = keep pipelined data only
+    memmove( _conn->buffer, _conn->buffer + _conn->used, _conn->count + 1);
+    _conn->used  = 0;
+
+#if HTTP_OUTPUT_SIZE
+    if ( _outputCount < (size_t) _bufferSize - _conn->count) {
+      memcpy( _conn->buffer + _conn->count + 1, _output, _outputCount);
+      _conn->tail  = _outputCount;                          // rest fits in slot buffer (behind pipelined data)
+      _outputCount = 0;                                     // = response buffer free for other slots
+      return;
+    }
+#endif
+    _sending = _conn;                                       // rest too large = response buffer kept
+    return;
+  }
 
-  CPRINT( F( "\r\n"));                                      // next line
+  _clientDone();                                            // response sent = keep or close session
 }
 
-// send content to client (content)
-void SimpleWebServer::_sendContent( const char* content)
+// keep client session open for next (pipelined) request, or close it
+void SimpleWebServerCore::_clientDone()
 {
-  if ( !_client.connected()) return;                        // check if client still active
+  if ( !_conn->keepAlive || ( _conn->sent != _conn->length) || !_conn->client.connected()) {
+    disconnect();                                           // close client session
+    return;
+  }
+
+  char* next = _conn->buffer + _conn->used;                 // start of pipelined data (if any)
 
-  CPRINT( content);                                         // send content
+  _conn->count -= _conn->used;                              // size of pipelined data
+  memmove( _conn->buffer, next, _conn->count + 1);          // move pipelined data to buffer start
+  _conn->parsed = 0;                                        // pipelined data not parsed yet
+  _conn->mode   = SERVER_METH_INIT;
+  _clientReset( _conn);                                     // response sent = start next one
+
+  _conn->requests++;                                        // count served request
+  _conn->timer = millis();                                  // start idle timer
+  _conn->state = CLIENT_READING;                            // wait for next request
 }
 
-// send content to client (FLASH content)
-void SimpleWebServer::_sendContent( const __FlashStringHelper* content)
+// reset response state of slot (new session or next request)
+void SimpleWebServerCore::_clientReset( connection* conn)
 {
-  if ( !_client.connected()) return;                        // check if client still active
-
-  CPRINT( content);                                         // send content
+  conn->header    = false;                                  // true = header  was sent
+  conn->pending   = false;                                  // true = header of respond( code) waits for content
+  conn->content   = false;                                  // true = content was sent
+  conn->newline   = false;                                  // true = extra CR/NL required
+  conn->length    = HTTP_SIZE_UNKNOWN;                      // no content size announced (yet)
+  conn->sent      = 0;
+  conn->chunked   = false;                                  // true = chunked response in progress
+  conn->etag      = NULL;                                   // no entity tag (yet)
+  conn->gzip      = false;                                  // true = content is gzip encoded
+  conn->vary      = false;                                  // true = content depends on Accept-Encoding
+  conn->cache     = false;                                  // true = response may be stored in cache
+  conn->tail      = 0;                                      // no unsent response in buffer
 }
 
 // close client connection
-void SimpleWebServer::_clientStop()
+void SimpleWebServerCore::_clientStop()
 {
-  if ( !_client.connected()) return;                        // check if client still active
+  if ( _conn->client.connected()) {                         // check if client still active
+    _sendPending();                                         // header of respond( code) not sent yet
+
+    if ( _conn->length == HTTP_SIZE_UNKNOWN) {              // if content is not size delimited
+      if ( _conn->content) { CPRINT( F( "\r\n")); }         // send EOL if content has been sent
+      if ( _conn->newline) { CPRINT( F( "\r\n")); }         // send EOL if extra /CR/NL required
+    }
 
-  if ( _content) { CPRINT( F( "\r\n")); }                   // send EOL if content has been sent
-  if ( _newline) { CPRINT( F( "\r\n")); }                   // send EOL if extra /CR/NL required
+    _flush();                                               // send pending response data
+    _conn->client.flush();
+  }
 
-  _client.flush(); _client.stop();                          // close client session
+  _conn->client.stop();                                     // close client session (free socket)
 }
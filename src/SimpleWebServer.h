@@ -11,13 +11,7 @@
 
 #include <Arduino.h>
 
-#if   defined(__AVR__)
-#include <SPI.h>
-#include <Ethernet.h>
-#elif defined(ESP8266)
-#include <ESP8266WiFi.h>
-#endif
-
+#include "SimpleTransport.h"
 #include "SimpleTask.h"
 #include "SimpleHttp.h"
 
@@ -26,43 +20,268 @@
 #define HTTP_PATH_SIZE     92
 #define MAX_PATHCOUNT       4
 #define MAX_ARGSCOUNT       4
+#ifndef MAX_HEADCOUNT                                       // size of header index per slot (0 = no header index)
+#define MAX_HEADCOUNT       5
+#endif
+#define HTTP_READ_TIMEOUT 1000                              // max time (ms) to receive a full request
+#define HTTP_KEEPALIVE_TIMEOUT 5000                         // max idle time (ms) of a persistent connection
+#define HTTP_KEEPALIVE_MAX      100                         // max requests per persistent connection
+#ifndef HTTP_WRITE_TIMEOUT
+#define HTTP_WRITE_TIMEOUT     1000                         // max time (ms) a client may take to accept response data
+#endif
+#ifndef HTTP_KEEPALIVE_IDLE
+#define HTTP_KEEPALIVE_IDLE    1000                         // min idle time (ms) before a new client may take over a persistent slot
+#endif
+#define HTTP_SIZE_UNKNOWN ((size_t) -1)                     // content size not known in advance
+#define HTTP_SIZE_CHUNKED ((size_t) -2)                     // content size not known in advance (sent in chunks)
+#ifndef HTTP_CHUNK_SIZE                                     // size of request body blocks / staged response chunks (0 = no staging)
+#define HTTP_CHUNK_SIZE    64
+#endif
+#ifndef HTTP_OUTPUT_SIZE                                    // size of response buffer (sent in one write, 0 = unbuffered)
+#if   defined(__AVR__)
+#define HTTP_OUTPUT_SIZE  128
+#else
+#define HTTP_OUTPUT_SIZE  512
+#endif
+#endif
+#define HTTP_ROUTE_SIZE    16                               // max length of device in route table (incl. '\0')
+#define HTTP_ASSET_SIZE    32                               // max length of path  in asset table (incl. '\0')
+#define HTTP_TYPE_SIZE     24                               // max length of content type in asset table (incl. '\0')
+#define HTTP_CACHE_HEAD   160                               // max size of cached response header
+
+#ifndef HTTP_ROUTE_ARENA                                    // size of route arena (tasks, route trie, device copies, asset tags, 0 = none)
+                                                            // AVR: route node ~10 + label, route callback ~12, device task ~18 + device,
+                                                            // asset 4 bytes (Simple_HTTP_Relay: 4 routes = 80 bytes), check with routeArena().peak()
+#if   defined(__AVR__)
+#define HTTP_ROUTE_ARENA  192
+#else
+#define HTTP_ROUTE_ARENA 1024
+#endif
+#endif
+#ifndef HTTP_SCRATCH_SIZE                                   // size of per-request scratch arena (for callbacks, 0 = none)
+#if   defined(__AVR__)
+#define HTTP_SCRATCH_SIZE  64
+#else
+#define HTTP_SCRATCH_SIZE 512
+#endif
+#endif
+
+#ifndef HTTP_MAX_CONNECTIONS                                // number of concurrent client connections
+#if   defined(__AVR__)
+#define HTTP_MAX_CONNECTIONS 1                              // RAM is scarce (each slot owns a buffer)
+#else
+#define HTTP_MAX_CONNECTIONS 4
+#endif
+#endif
 
-extern int returnCode;
+#ifndef HTTP_METRICS_ROUTES                                 // max number of routes with own metrics (0 = no metrics)
+#if   defined(__AVR__)
+#define HTTP_METRICS_ROUTES  0                              // RAM is scarce (no metrics)
+#else
+#define HTTP_METRICS_ROUTES  8
+#endif
+#endif
+#ifndef HTTP_METRICS_STATUS                                 // max number of response codes with own counter
+#define HTTP_METRICS_STATUS  8
+#endif
+#ifndef HTTP_METRICS_BUCKET_LIST                            // upper bounds (us) of latency histogram buckets
+#define HTTP_METRICS_BUCKET_LIST 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000
+#define HTTP_METRICS_BUCKETS 9                              // number of entries in HTTP_METRICS_BUCKET_LIST
+#endif
+
+// case insensitive hash of a header label (usable at compile time)
+constexpr uint16_t HTTP_Hash( const char* label, uint16_t hash = 5381)
+{
+  return *label ? HTTP_Hash( label + 1, ( hash * 33) ^ ( *label | 0x20)) : hash;
+}
+
+#ifndef HTTP_HEADER_LIST                                    // request headers kept in header index (max MAX_HEADCOUNT)
+#define HTTP_HEADER_LIST  HTTP_Hash( "Connection"), HTTP_Hash( "Content-Length"), HTTP_Hash( "Content-Type"), \
+                          HTTP_Hash( "If-None-Match"), HTTP_Hash( "Accept-Encoding")
+#endif
+
+extern int returnCode;                                      // response code of TaskFunc callbacks (legacy)
+
+class SimpleWebServerCore;
+class RequestContext;
+
+typedef void (*BodyFunc)( const char*, size_t);             // request body callback (data, size)
+typedef void (*ContextFunc)( RequestContext&);              // request callback (request context)
+
+constexpr TaskFunc    HTTP_TaskOf   ( TaskFunc    func) { return func; }
+constexpr TaskFunc    HTTP_TaskOf   ( ContextFunc     ) { return NULL; }
+constexpr ContextFunc HTTP_ContextOf( TaskFunc        ) { return NULL; }
+constexpr ContextFunc HTTP_ContextOf( ContextFunc func) { return func; }
+                                                            // split callback in route table entry by type
+
+struct SimpleWebRoute                                       // route table entry (declare table as PROGMEM)
+{
+  uint16_t   hash;                                          // hash of device
+  HTTPMethod method;                                        // targeted method
+  char       device[HTTP_ROUTE_SIZE];                       // targeted device (first path item)
+  TaskFunc   func;                                          // callback function (or NULL)
+  ContextFunc context;                                      // callback function with request context (or NULL)
+};
+
+#define HTTP_ROUTE( DEVICE, METHOD, FUNC) { HTTP_Hash( DEVICE), METHOD, DEVICE, HTTP_TaskOf( FUNC), HTTP_ContextOf( FUNC) }
+                                                            // route table entry (device, method, callback)
+
+struct SimpleWebAsset                                       // static asset entry (declare table as PROGMEM)
+{
+  uint16_t   hash;                                          // hash of path
+  char       path[HTTP_ASSET_SIZE];                         // full path (e.g. "/index.html")
+  char       type[HTTP_TYPE_SIZE];                          // content type (e.g. "text/html")
+  PGM_P      data;                                          // content (PROGMEM, NULL = gzip variant only)
+  size_t     size;                                          // content size
+  PGM_P      gzip;                                          // gzip compressed content (PROGMEM, NULL = none)
+  size_t     gzipSize;                                      // gzip compressed content size
+};
+
+#define HTTP_ASSET( PATH, TYPE, DATA) { HTTP_Hash( PATH), PATH, TYPE, DATA, sizeof( DATA) - 1, NULL, 0 }
+                                                            // asset table entry (path, content type, PROGMEM string)
+#define HTTP_ASSET_GZIP( PATH, TYPE, DATA, GZIP) { HTTP_Hash( PATH), PATH, TYPE, DATA, sizeof( DATA) - 1, (PGM_P) GZIP, sizeof( GZIP) }
+                                                            // asset table entry (path, content type, PROGMEM string, PROGMEM gzip data)
+#define HTTP_ASSET_GZIP_ONLY( PATH, TYPE, GZIP) { HTTP_Hash( PATH), PATH, TYPE, NULL, 0, (PGM_P) GZIP, sizeof( GZIP) }
+                                                            // asset table entry (path, content type, PROGMEM gzip data)
+
+class SimpleArena                                           // bump allocator on fixed memory (no heap)
+{
+public:
+  SimpleArena( char*, size_t);                              // create arena (memory, size)
+
+  void*  alloc( size_t);                                    // allocate memory (NULL = arena full)
+  char*  copy( const char*, size_t);                        // allocate copy of string (string, length)
+  char*  copy( const char*);                                // allocate copy of string
+  void   reset();                                           // release all allocations
+
+  size_t size();                                            // size of arena
+  size_t used();                                            // bytes in use
+  size_t peak();                                            // high-water mark of bytes in use
+  size_t failed();                                          // number of failed allocations
+
+protected:
+  char*  _memory;                                           // arena memory
+  size_t _size;                                             // size of arena memory
+  size_t _used;                                             // bytes in use
+  size_t _peak;                                             // high-water mark
+  size_t _failed;                                           // failed allocations
+};
 
 class SimpleWebServerTask : public SimpleTask               // single callback task
 {
 public:
-  SimpleWebServerTask( TaskFunc, const char*, HTTPMethod = HTTP_ANY);
-                                                            // create callbacl task (callback, device, method)
- ~SimpleWebServerTask();
+  SimpleWebServerTask( TaskFunc, const char*, HTTPMethod, SimpleArena&, BodyFunc = NULL);
+                                                            // create callbacl task (callback, device, method, arena for device, body callback)
+  SimpleWebServerTask( ContextFunc, const char*, HTTPMethod, SimpleArena&, BodyFunc = NULL);
+                                                            // create callbacl task (context callback, device, method, arena for device, body callback)
+
+  static void* operator new( size_t, void* memory) { return memory; }
+  static void  operator delete( void*) {}
+  static void  operator delete( void*, void*) {}
+                                                            // tasks live in the route arena (placement only) and are never
+                                                            // freed: delete (e.g. by the task list) only runs the destructor
 
   const char* device();                                     // return targeted device
+  uint16_t    hash();                                       // return hash of targeted device
   HTTPMethod  method();                                     // return targeted HTTP method
+  ContextFunc context();                                    // return context callback (NULL = TaskFunc callback)
+  BodyFunc    body();                                       // return body callback (NULL = onBody callback)
 
 protected:
   char*      _device;                                       // targeted device for this task
+  uint16_t   _hash;                                         // hash of targeted device
   HTTPMethod _method;                                       // targeted method for this task
+  ContextFunc _context;                                     // context callback for this task
+  BodyFunc   _body;                                         // request body callback for this task
+
+  void _init( const char*, SimpleArena&);                   // store targeted device (device, arena)
 };
 
-class SimpleWebServer : public SimpleTaskList               // webserver with multiple callback tasks
+class RequestContext                                        // request handed to callbacks (request data, response, status)
 {
 public:
-  SimpleWebServer( char*, int = 80);                         // create webserver (port)
+  RequestContext( SimpleWebServerCore&, uint8_t);           // create context (server, connection slot)
+
+  HTTPMethod  method();                                     // return HTTP method
+  bool        method( HTTPMethod);                          // true = active method equals given method
+  int         pathCount();                                  // return number of path items
+  const char* path( uint8_t);                               // return n-th part of request path
+  bool        path( uint8_t, const char*);                  // true = n-th part equals string
+  int         argsCount();                                  // return number of arguments
+  const char* arg( const char*);                            // return value of argument with a specfic label
+  bool        arg( const char*, const char*);               // true = argument with label=value exists
+  const char* header( const char*);                         // return value of header with a specific label
+  const char* param( const char*);                          // return value of path parameter (e.g. "/relays/{id}")
+  long        paramInt( const char*);                       // return value of integer path parameter ({id:int})
+
+  int         status();                                     // return response code
+  void        status( int);                                 // set response code (sent after callback)
+
+  void respond( int = 200);                                 // send response (code = 200 OK, content ends at session close)
+  void respond( int, const char*, size_t);                  // send response (code, content type, content size)
+  void respond( int, const char*, const char* = NULL);      // send response (code, content type, content)
+  void sendContent( const char*);                           // send response (content)
+  void sendLine( const char* = NULL, const char* = NULL);   // send response (content) + LF
+  void sendLine( const __FlashStringHelper*, const char* = NULL);
+  void beginChunked( int = 200, const char* = NULL);        // start chunked response (code, content type)
+  void writeChunk( const char*, size_t);                    // send response chunk (data, size)
+  void writeChunk( const char*);                            // send response chunk (content)
+  void endChunked();                                        // end chunked response (last chunk)
+
+  Print&      stream();                                     // response content stream (e.g. root.printTo( request.stream()))
+  void*       scratch( size_t);                             // allocate request scratch memory (NULL = arena full)
+  char*       scratch( const char*);                        // allocate request scratch copy of string
+
+protected:
+  SimpleWebServerCore& _server;                             // server handling the request
+  uint8_t              _slot;                               // connection slot of the request
+
+  SimpleWebServerCore& _select();                           // make slot the active connection of server
+};
+
+class SimpleWebServerCore : public SimpleTaskList, public Print
+{                                                           // webserver with multiple callback tasks (and response stream)
+public:                                                     // (capacities set by BasicWebServer / SimpleWebServer)
   void begin();                                             // start webserver
 
   bool connect();                                           // check on incoming connection (HTTP request)
   void disconnect();                                        // close connection
 
-  void handleOn( TaskFunc, const char*, HTTPMethod);        // attach callback function (callback, device, method)
+  bool handleOn( TaskFunc, const char*, HTTPMethod, BodyFunc = NULL);
+                                                            // attach callback function (callback, device, method, body callback), false = route arena full
+  bool handleOn( ContextFunc, const char*, HTTPMethod, BodyFunc = NULL);
+                                                            // attach callback function (context callback, device, method, body callback), false = route arena full
+  void handleOn( const SimpleWebRoute*, size_t);            // attach route table in PROGMEM (table, size)
+  template< size_t N>
+  void handleOn( const SimpleWebRoute (&routes)[N]) { handleOn( routes, N); }
+  void serveStatic( const SimpleWebAsset*, size_t);         // attach static asset table in PROGMEM (table, size)
+  template< size_t N>
+  void serveStatic( const SimpleWebAsset (&assets)[N]) { serveStatic( assets, N); }
+  void onBody( BodyFunc);                                   // attach default request body callback (data, size)
   void handleRequest();                                     // route incoming requests to the proper callback
+  void firstMatch( bool = true);                            // route to first matching callback only (else 404 / 405)
+  void cache( size_t);                                      // cache GET responses (memory budget, 0 = off)
+  void invalidate( const char* = NULL);                     // drop cached responses for device (NULL = all)
+  SimpleArena& routeArena();                                // route arena (tasks, route trie), e.g. for peak()
+  SimpleArena& scratchArena();                              // per-request scratch arena (reset for each request)
+  void metrics( const char* = "/metrics");                  // serve metrics on path (Prometheus text, NULL = off)
   void handle();
 
-  void respond( int = 200);                                 // send response (code = 200 OK)
+  void respond( int = 200);                                 // send response (code = 200 OK, content ends at session close)
   void respond( int, const char*, size_t);                  // send response (code, content type, content)
   void respond( int, const char*, const char* = NULL);      // send response (code, content type, content)
   void sendContent(  const char*);                          // send response (content)
   void sendLine( const char* = NULL, const char* = NULL);   // send response (content) + LF
   void sendLine( const __FlashStringHelper*, const char* = NULL);
+  void beginChunked( int = 200, const char* = NULL);        // start chunked response (code, content type)
+  void writeChunk( const char*, size_t);                    // send response chunk (data, size)
+  void writeChunk( const char*);                            // send response chunk (content)
+  void writeChunk( const __FlashStringHelper*);             // send response chunk (FLASH content)
+  void endChunked();                                        // end chunked response (last chunk)
+
+  size_t write( uint8_t);                                   // send response content (Print interface)
+  size_t write( const uint8_t*, size_t);                    // send response content (Print interface)
+  using Print::write;
 
 
   char*       name();                                       // return server name
@@ -76,22 +295,22 @@ public:
   int         argsCount();                                  // return number of (recognized) arguments
   const char* arg( const char*);                            // return value of argument with a specfic label
   bool        arg( const char*, const char*);               // true = argument with label=value exists
+  const char* header( const char*);                         // return value of header with a specific label
+  const char* param( const char*);                          // return value of path parameter (e.g. "/relays/{id}")
+  long        paramInt( const char*);                       // return value of integer path parameter ({id:int})
 
 protected:
+  friend class RequestContext;
+
+  SimpleWebServerCore( char*, int = 80);                    // create webserver (name, port), see BasicWebServer
+
   char*           _name;                                    // server name
   int             _port;                                    // port number
 
-#if   defined(__AVR__)
-  EthernetServer _server;                                   // server object (Ethernet based)
-  EthernetClient _client;                                   // client object (Ethernet based)
-#elif defined(ESP8266)
-  WiFiServer     _server;                                   // server object (WiFi based)
-  WiFiClient     _client;                                   // client object (WiFi based)
-#endif
+  typedef HTTP_TRANSPORT_SERVER server_t;                   // server object (see SimpleTransport.h)
+  typedef HTTP_TRANSPORT_CLIENT client_t;                   // client object (see SimpleTransport.h)
 
-  char           _buffer[HTTP_BUFFER_SIZE];                 // buffer for HTTP request
-  HTTPMethod     _method;                                   // method of HTTP request
-  char*          _version;                                  // vesion of hTTP request
+  server_t       _server;                                   // server object (Ethernet / WiFi / socket based)
 
   typedef char*  pathItem;                                  // pathItem object (/...)
   struct         argument {                                 // argument object (?...)
@@ -99,19 +318,188 @@ protected:
     char* value;                                            // value of parameter
   };
 
-  int            _pathCount;                                // number of path items
-  int            _argsCount;                                // number of arguments
-  pathItem       _path[MAX_PATHCOUNT];                      // path item list
-  argument       _args[MAX_ARGSCOUNT];                      // argument list
+  struct         paramItem {                                // path parameter object ({label})
+    const char* label;                                      // label of parameter (route pattern)
+    const char* value;                                      // value of parameter (path item)
+    long        number;                                     // value of integer parameter
+  };
+
+  struct         routeFunc {                                // route callback (per method)
+    HTTPMethod method;                                      // targeted method
+    TaskFunc   func;                                        // callback function (or NULL)
+    ContextFunc context;                                    // context callback function (or NULL)
+    BodyFunc   body;                                        // request body callback (NULL = onBody callback)
+    routeFunc* next;                                        // next callback on same route
+    char*      pattern;                                     // route pattern (metrics label, NULL = no metrics)
+  };
+
+  struct         routeNode {                                // route trie node (one path item)
+    char*      label;                                       // path item or parameter label
+    uint8_t    type;                                        // text / int parameter / string parameter
+    routeNode* child;                                       // first child node (next path item)
+    routeNode* next;                                        // next sibling node (same path item)
+    routeFunc* funcs;                                       // callbacks for route ending here
+  };
+
+  struct         headerItem {                               // header object (label: value)
+    uint16_t hash;                                          // hash of label
+    char*    label;                                         // label of header
+    char*    value;                                         // value of header
+  };
+
+  struct         cacheEntry {                               // cached response (key + header + content)
+    cacheEntry* next;                                       // next entry (less recently used)
+    uint16_t    hash;                                       // hash of key
+    uint16_t    keySize;                                    // size of key (e.g. "/relays?state=on")
+    uint16_t    headSize;                                   // size of header (without Connection)
+    size_t      bodySize;                                   // size of content
+    char        data[1];                                    // key + header + content
+  };
+
+  struct         connection {                               // connection slot (one per client)
+    client_t      client;                                   // client session
+    uint8_t       state;                                    // connection state (accepting / reading / ...)
+    unsigned long timer;                                    // start time (ms) of current request
+    uint8_t       requests;                                 // number of requests served on this session
+    bool          keepAlive;                                // true = keep session open after response
+
+    char*         buffer;                                   // buffer for HTTP request (BufSize)
+    uint16_t      count;                                    // number of bytes in buffer
+    uint16_t      parsed;                                   // number of bytes handled by parser
+    uint16_t      line;                                     // start of current header line
+    uint8_t       mode;                                     // parser state (kept between reads)
+    int           error;                                    // HTTP error code for invalid request
+    uint8_t       body;                                     // body state (none / data / chunked ...)
+    unsigned long bodyLeft;                                 // body (or chunk) bytes still to be received
+    BodyFunc      bodyFunc;                                 // body callback of matched route (NULL = body dropped)
+    bool          expect;                                   // true = client expects "100 Continue"
+    uint8_t       allow;                                    // methods allowed on requested path (405 response)
+    uint16_t      used;                                     // length of current request (pipelined data follows)
+    uint16_t      tail;                                     // unsent response bytes kept in buffer (behind pipelined data)
+    HTTPMethod    method;                                   // method of HTTP request
+    char*         version;                                  // vesion of hTTP request
+
+    uint8_t       pathCount;                                // number of path items
+    uint8_t       argsCount;                                // number of arguments
+    pathItem*     path;                                     // path item list (MaxPath)
+    argument*     args;                                     // argument list (MaxArgs)
+    uint8_t       paramCount;                               // number of path parameters
+    paramItem*    params;                                   // path parameters (MaxPath, captured by route trie)
+    uint8_t       headCount;                                // number of (indexed) headers
+#if MAX_HEADCOUNT
+    headerItem    heads[MAX_HEADCOUNT];                     // header index (pointers into buffer)
+#endif
+
+    bool          header;                                   // true = header  has been sent
+    bool          pending;                                  // true = header of respond( code) waits for content
+    bool          content;                                  // true = content has been sent
+    bool          newline;                                  // true = extra "/r/n" required
+    size_t        length;                                   // announced content size (or HTTP_SIZE_UNKNOWN / _CHUNKED)
+    bool          chunked;                                  // true = chunked response in progress
+    const char*   etag;                                     // entity tag of response (NULL = none)
+    bool          gzip;                                     // true = content is gzip encoded
+    bool          vary;                                     // true = content depends on Accept-Encoding
+    bool          cache;                                    // true = response may be stored in cache
+    int           status;                                   // response code (sent after callbacks)
+    size_t        sent;                                     // content size sent so far
+  };
+
+  routeNode      _routeRoot;                                // route trie (patterns starting with '/')
+  const SimpleWebRoute* _routes;                            // route table (PROGMEM)
+  size_t         _routeCount;                               // number of entries in route table
+  const SimpleWebAsset* _assets;                            // static asset table (PROGMEM)
+  size_t         _assetCount;                               // number of entries in asset table
+  uint32_t*      _assetTags;                                // content hash per asset (route arena, NULL = hashed per request)
+  size_t         _assetRoom;                                // number of entries in _assetTags (smaller table = reused)
+  bool           _firstMatch;                               // true = stop at first matching callback
+#if HTTP_OUTPUT_SIZE
+  char           _output[HTTP_OUTPUT_SIZE + 1];             // response buffer (shared by all slots)
+#endif
+  size_t         _outputCount;                              // number of bytes in response buffer
+  size_t         _frameAt;                                  // chunk framed in response buffer (HTTP_SIZE_UNKNOWN = none)
+  connection*    _sending;                                  // slot still sending the response buffer (NULL = none)
+  BodyFunc       _bodyFunc;                                 // default request body callback (routes without own callback)
+#if HTTP_CHUNK_SIZE
+  char           _chunk[HTTP_CHUNK_SIZE];                   // request body block / staged response chunk (shared by all slots)
+#endif
+  size_t         _chunkCount;                               // number of bytes in staged response chunk
+#if HTTP_ROUTE_ARENA
+  char           _routeMemory[HTTP_ROUTE_ARENA];            // route arena memory
+#endif
+  SimpleArena    _routeArena;                               // route arena (tasks, route trie)
+#if HTTP_SCRATCH_SIZE
+  char           _scratchMemory[HTTP_SCRATCH_SIZE];         // scratch arena memory
+#endif
+  SimpleArena    _scratchArena;                             // per-request scratch arena
+  cacheEntry*    _cacheList;                                // cached responses (most recently used first)
+  size_t         _cacheBudget;                              // max memory used by cache
+  size_t         _cacheUsed;                                // memory used by cache
+  cacheEntry*    _cacheNew;                                 // response being stored (NULL = none)
+  size_t         _cacheCount;                               // bytes stored in new entry
+  size_t         _cacheMax;                                 // bytes available in new entry
+  bool           _cacheOn;                                  // true = output is stored in new entry
+
+#if HTTP_METRICS_ROUTES
+  struct         metricsRoute {                             // metrics per route (and method)
+    const char*  label;                                     // route pattern / device / asset path
+    bool         flash;                                     // true = label in PROGMEM
+    HTTPMethod   method;                                    // request method
+    unsigned long count[HTTP_METRICS_BUCKETS + 1];          // requests per latency bucket (last = +Inf)
+    unsigned long long micros;                              // sum of latencies (us)
+  };
+
+  struct         metricsStatus {                            // responses per response code
+    int           code;                                     // response code (0 = other codes)
+    unsigned long count;                                    // number of responses
+  };
+
+  const char*    _metricsPath;                              // path of metrics route (NULL = off)
+  metricsRoute   _metricsRoutes[HTTP_METRICS_ROUTES + 1];   // metrics per route (last = other routes)
+  uint8_t        _metricsRouteCount;                        // number of routes in use
+  metricsStatus  _metricsStatus[HTTP_METRICS_STATUS + 1];   // responses per code (last = other codes)
+  uint8_t        _metricsStatusCount;                       // number of codes in use
+  unsigned long long _metricsBytesIn;                       // bytes received from clients
+  unsigned long long _metricsBytesOut;                      // bytes sent to clients
+  unsigned long  _metricsErrors;                            // invalid requests (parse errors)
+  const char*    _metricsLabel;                             // route of active request (NULL = none yet)
+  bool           _metricsFlash;                             // true = route label in PROGMEM
+  unsigned long  _metricsStart;                             // start of active request (micros)
+#endif
+
+  connection*    _conns;                                    // connection pool (MaxConns, owned by BasicWebServer)
+  connection*    _conn;                                     // active connection (request being handled)
+  uint8_t        _next;                                     // next slot to service (round-robin)
+  uint8_t        _connCount;                                // number of connection slots
+  uint16_t       _bufferSize;                               // size of request buffer per slot
+  uint8_t        _maxPath;                                  // max number of path items per request
+  uint8_t        _maxArgs;                                  // max number of arguments per request
+
+  void _setup( connection*, uint8_t, uint16_t, uint8_t, uint8_t);
+                                                            // attach slot storage (slots, count, buffer size, max path, max args)
 
-  bool           _header;                                   // true = header  has been sent
-  bool           _content;                                  // true = content has been sent
-  bool           _newline;                                  // true = extra "/r/n" required
+  bool _accept();                                           // assign new client to a free slot
+  bool _advance( connection*);                              // progress slot (true = request available)
+  size_t _parseBody( const char*, size_t);                  // deliver request body to body callback
+  BodyFunc _bodyRoute();                                    // body callback of route matching request (NULL = none)
+
+  void       _execute( TaskFunc, ContextFunc);              // execute callback (with request context)
+  bool       _serveAsset();                                 // send static asset matching request (false = none)
+  uint32_t   _assetTag( const SimpleWebAsset&);             // content hash of asset (entity tag)
+  bool       _routeAdd( TaskFunc, ContextFunc, const char*, HTTPMethod, BodyFunc);
+                                                            // add route pattern to route trie (false = route arena full)
+  routeNode* _routeNode( routeNode*, const char*, size_t, uint8_t);
+                                                            // find or create child node (parent, label, size, type)
+  routeNode* _routeMatch( routeNode*, int);                 // match path items with route trie (node, depth)
 
   void _handleRequest();
-  bool _parseRequest();                                     // break down HTTP request
+  uint8_t _parseRequest();                                  // break down HTTP request (incremental)
+  bool _parseHeader( char*);                                // handle request header line (true = keep in buffer)
 
-  void _sendHeader( int, const char* = NULL, size_t = 0);   // send response header (code, content type, content size)
+  void _sendHeader( int, const char* = NULL, size_t = HTTP_SIZE_UNKNOWN);
+                                                            // send response header (code, content type, content size)
+  void _sendPending();                                      // send header of respond( code) (content follows)
+  void _respondEmpty( int);                                 // send response without content (Content-Length: 0)
+  bool _sendHeaderBlock( int, const char*);                 // send prebuilt header (code, content type)
   void _sendHeaderBegin( int);                              // send response header (code)
   void _sendHeaderValue( const char*, const char*);         // send response header value (label, value)
   void _sendHeaderValue( const __FlashStringHelper*, const char*);
@@ -119,8 +507,81 @@ protected:
   void _sendHeaderClose();                                  // send end of header message
   void _sendContent( const char*);                          // send response content (content)
   void _sendContent( const __FlashStringHelper*);           // send response content (FLASH content)
+  void _sendContent_P( PGM_P, size_t);                      // send response content (FLASH data, size)
+
+  void _write( const char*, size_t);                        // add data to response buffer (data, size)
+  void _write_P( PGM_P, size_t);                            // add FLASH data to response buffer (data, size)
+  void _write( const char*);                                // add string to response buffer
+  void _write( const __FlashStringHelper*);                 // add FLASH string to response buffer
+  size_t _send( const char*, size_t, bool);                // send data to client (data, size, true = wait), returns bytes sent
+  bool _flush( bool = true);                                // send response buffer (true = wait), false = data left
+  void _flushChunk();                                       // send staged response chunk
+  void _frameBegin();                                       // start chunk framed in response buffer
+  void _frameWrite( const char*, size_t);                   // add data to framed chunk (data, size)
+  void _frameEnd();                                         // close framed chunk (patch size line)
+
+  size_t _cacheKey( char*);                                 // build cache key of request (key buffer)
+  bool   _cacheSend();                                      // send cached response (false = not cached)
+  void   _cacheBegin( size_t);                              // start storing response (content size)
+  void   _cacheStore( const char*, size_t, bool);           // store response output (data, size, FLASH)
+  void   _cacheEnd();                                       // add stored response to cache
+  void   _cacheFree( cacheEntry*);                          // remove entry from cache
+
+  bool   _metricsServe();                                   // send metrics if requested (false = other path)
+  void   _metricsBegin();                                   // start metrics of active request
+  void   _metricsRoute( const char*, bool);                 // set route of active request (label, PROGMEM)
+  void   _metricsEnd();                                     // add active request to metrics
+  void   _metricsCount( int);                               // count response code
+  void   _metricsError( int);                               // count invalid request (response code)
+  void   _metricsBytes( size_t, bool);                      // count bytes (size, true = received)
 
+  void _clientNext();                                       // send response, then keep or stop client session
+  void _clientDone();                                       // keep client session for next request (or stop)
   void _clientStop();                                       // stop client session
+  void _clientReset( connection*);                          // reset response state of slot
+};
+
+template< size_t BufSize = HTTP_BUFFER_SIZE, uint8_t MaxPath = MAX_PATHCOUNT, uint8_t MaxArgs = MAX_ARGSCOUNT, uint8_t MaxConns = HTTP_MAX_CONNECTIONS>
+class BasicWebServer : public SimpleWebServerCore           // webserver with capacities set at compile time
+{                                                           // (request buffer, path items, arguments, connection slots)
+  static_assert( BufSize >= 32     , "BasicWebServer: BufSize must hold at least a request line (32 bytes)");
+  static_assert( BufSize <= 0xFFFF , "BasicWebServer: BufSize must fit the 16 bit buffer index (max 65535)");
+  static_assert( MaxPath >= 1      , "BasicWebServer: MaxPath must be at least 1 (path item of identify request)");
+  static_assert( MaxArgs >= 1      , "BasicWebServer: MaxArgs must be at least 1");
+  static_assert( MaxConns >= 1     , "BasicWebServer: MaxConns must be at least 1");
+
+public:
+  BasicWebServer( char* name, int port = 80)                // create webserver (name, port)
+  : SimpleWebServerCore( name, port)
+  {
+    for ( uint8_t i = 0; i < MaxConns; i++) {               // attach storage to each slot
+      _slots[ i].buffer = _buffers[ i];
+      _slots[ i].path   = _paths  [ i];
+      _slots[ i].params = _params [ i];
+      _slots[ i].args   = _args   [ i];
+    }
+
+    _setup( _slots, MaxConns, BufSize, MaxPath, MaxArgs);
+  }
+
+  static constexpr size_t slotSize()                        // RAM used per connection slot
+  {
+    return sizeof( connection) + BufSize + MaxPath * ( sizeof( pathItem) + sizeof( paramItem)) + MaxArgs * sizeof( argument);
+  }
+
+  static constexpr size_t footprint()                       // RAM used by server instance (e.g. static_assert( server.footprint() < 1024))
+  {
+    return sizeof( BasicWebServer);
+  }
+
+protected:
+  connection _slots  [ MaxConns];                           // connection pool
+  char       _buffers[ MaxConns][ BufSize];                 // request buffer per slot
+  pathItem   _paths  [ MaxConns][ MaxPath];                 // path items per slot
+  paramItem  _params [ MaxConns][ MaxPath];                 // path parameters per slot
+  argument   _args   [ MaxConns][ MaxArgs];                 // arguments per slot
 };
 
+typedef BasicWebServer<> SimpleWebServer;                   // webserver with default capacities (HTTP_BUFFER_SIZE, ...)
+
 #endif // SIMPLEWEBSERVER_H